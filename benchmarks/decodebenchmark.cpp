@@ -0,0 +1,301 @@
+// Copyright (c) 2026 Manuel Schneider
+
+// Offline benchmark of reply decoding and item construction over the recorded fixtures.
+// Reports throughput, heap allocations per item and peak heap usage per stage and handler.
+//
+// Usage: spotify_decode_benchmark [fixtures dir] [milliseconds per benchmark]
+
+#include "api.h"
+#include "handlers.h"
+#include "items.h"
+#include "library.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QNetworkReply>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <malloc.h>
+#include <memory>
+#include <sys/resource.h>
+#include <vector>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+// -------------------------------------------------------------------------------------------------
+// Heap accounting. Interposes the glibc allocator, Qt allocates its containers with malloc, such
+// that replacing operator new alone would miss most of the decoding.
+
+namespace
+{
+
+atomic<quint64> allocations = 0;
+atomic<qint64> live_bytes = 0;
+atomic<qint64> peak_bytes = 0;
+
+void track(qint64 delta)
+{
+    const auto live = live_bytes += delta;
+    for (auto peak = peak_bytes.load(); live > peak && !peak_bytes.compare_exchange_weak(peak, live);) {}
+}
+
+void allocated(void *p)
+{
+    if (p)
+    {
+        ++allocations;
+        track(static_cast<qint64>(malloc_usable_size(p)));
+    }
+}
+
+}
+
+extern "C"
+{
+
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t, size_t);
+void *__libc_realloc(void *, size_t);
+void *__libc_memalign(size_t, size_t);
+void __libc_free(void *);
+
+void *malloc(size_t size) noexcept
+{
+    auto *p = __libc_malloc(size);
+    allocated(p);
+    return p;
+}
+
+void *calloc(size_t n, size_t size) noexcept
+{
+    auto *p = __libc_calloc(n, size);
+    allocated(p);
+    return p;
+}
+
+void *realloc(void *p, size_t size) noexcept
+{
+    const auto old = p ? static_cast<qint64>(malloc_usable_size(p)) : 0;
+    auto *q = __libc_realloc(p, size);
+    if (q)
+    {
+        ++allocations;
+        track(static_cast<qint64>(malloc_usable_size(q)) - old);
+    }
+    else if (p && size == 0)  // freed
+        track(-old);
+    return q;
+}
+
+void *memalign(size_t alignment, size_t size) noexcept
+{
+    auto *p = __libc_memalign(alignment, size);
+    allocated(p);
+    return p;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) noexcept { return memalign(alignment, size); }
+
+int posix_memalign(void **p, size_t alignment, size_t size) noexcept
+{ return (*p = memalign(alignment, size)) ? 0 : ENOMEM; }
+
+void free(void *p) noexcept
+{
+    if (p)
+        track(-static_cast<qint64>(malloc_usable_size(p)));
+    __libc_free(p);
+}
+
+}
+
+// -------------------------------------------------------------------------------------------------
+
+namespace
+{
+
+// Serves a fixture as a finished reply.
+class FixtureReply : public QNetworkReply
+{
+public:
+
+    explicit FixtureReply(const QByteArray &data) : data_(data)
+    { setOpenMode(QIODevice::ReadOnly); }
+
+    void abort() override {}
+
+    qint64 bytesAvailable() const override
+    { return data_.size() - pos_ + QNetworkReply::bytesAvailable(); }
+
+protected:
+
+    qint64 readData(char *data, qint64 max_size) override
+    {
+        const auto n = min(max_size, data_.size() - pos_);
+        memcpy(data, data_.constData() + pos_, static_cast<size_t>(n));
+        pos_ += n;
+        return n;
+    }
+
+private:
+
+    const QByteArray data_;
+    qint64 pos_ = 0;
+
+};
+
+chrono::milliseconds budget{500};
+
+// Runs f repeatedly for the budget. f processes `units` items per call.
+template<class F>
+void run(const QString &name, quint64 units, F &&f)
+{
+    f();  // warm up
+
+    const auto allocations_before = allocations.load();
+    const auto live_before = live_bytes.load();
+    peak_bytes = live_before;
+
+    QElapsedTimer timer;
+    timer.start();
+    quint64 calls = 0;
+    do {
+        f();
+        ++calls;
+    } while (!timer.hasExpired(budget.count()));
+    const auto ns = timer.nsecsElapsed();
+
+    const auto total_units = static_cast<double>(units * calls);
+    printf("%-36s %12.0f %12.1f %12.1f\n",
+           qPrintable(name),
+           total_units * 1e9 / static_cast<double>(ns),
+           static_cast<double>(allocations.load() - allocations_before) / total_units,
+           static_cast<double>(peak_bytes.load() - live_before) / 1024.);
+}
+
+QJsonDocument readFixture(const QDir &dir, const QString &name)
+{
+    QFile file(dir.filePath(name));
+    if (!file.open(QIODevice::ReadOnly))
+        qFatal("Failed to open fixture %s: %s", qPrintable(file.fileName()), qPrintable(file.errorString()));
+    return QJsonDocument::fromJson(file.readAll());
+}
+
+// The reply truncated to the first `size` items, the container is null for library replies.
+QJsonDocument truncated(const QJsonDocument &doc, const QString &container, qsizetype size)
+{
+    auto paging = container.isNull() ? doc.object() : doc[container].toObject();
+    auto items = paging[u"items"_s].toArray();
+    while (items.size() > size)
+        items.removeLast();
+    paging[u"items"_s] = items;
+    paging[u"limit"_s] = static_cast<int>(size);
+
+    if (container.isNull())
+        return QJsonDocument(paging);
+    auto object = doc.object();
+    object[container] = paging;
+    return QJsonDocument(object);
+}
+
+QString containerOf(SearchType type) { return typeString(type) + u's'; }
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication qapp(argc, argv);
+
+    const auto args = qapp.arguments();
+    const QDir fixtures(args.size() > 1 ? args[1] : QStringLiteral(FIXTURES_DIR));
+    if (args.size() > 2)
+        budget = chrono::milliseconds(args[2].toLongLong());
+
+    API api;
+    Library library(api);  // not loaded, the track handler has no local items
+    vector<unique_ptr<SpotifySearchHandler>> handlers;
+    handlers.emplace_back(make_unique<TrackSearchHandler>(api, library));
+    handlers.emplace_back(make_unique<ArtistSearchHandler>(api));
+    handlers.emplace_back(make_unique<AlbumSearchHandler>(api));
+    handlers.emplace_back(make_unique<PlaylistSearchHandler>(api));
+    handlers.emplace_back(make_unique<ShowSearchHandler>(api));
+    handlers.emplace_back(make_unique<EpisodeSearchHandler>(api));
+    handlers.emplace_back(make_unique<AudiobookSearchHandler>(api));
+
+    printf("%-36s %12s %12s %12s\n", "benchmark", "items/s", "allocs/item", "peak KiB");
+
+    // Per handler, for search pages (non-empty query) and library pages (empty query)
+    vector<QJsonArray> image_arrays;
+    vector<QJsonObject> artists;
+    for (size_t i = 0; i < handlers.size(); ++i)
+    {
+        const auto &handler = handlers[i];
+        const auto type = static_cast<SearchType>(i);  // in the order of SearchType
+        for (const auto search : {true, false})
+        {
+            const auto fixture = readFixture(fixtures, u"%1_%2.json"_s
+                                                          .arg(search ? u"search"_s : u"library"_s,
+                                                               handler->id()));
+            const auto container = search ? containerOf(type) : QString{};
+            const auto query = search ? u"fixture"_s : QString{};
+
+            for (const qsizetype size : {10, 50})
+            {
+                const auto doc = truncated(fixture, container, size);
+                const auto bytes = doc.toJson();
+                const auto label = u"%1 %2 %3"_s.arg(handler->id(), search ? u"search"_s : u"library"_s)
+                                       .arg(size);
+
+                run(u"parseJson "_s + label, static_cast<quint64>(size), [&] {
+                    FixtureReply reply(bytes);
+                    if (!api.parseJson(&reply))
+                        qFatal("Failed to parse %s", qPrintable(label));
+                });
+
+                run(u"handleReply "_s + label, static_cast<quint64>(size), [&] {
+                    if (handler->handleReply(query, doc).size() != static_cast<size_t>(size))
+                        qFatal("Unexpected item count in %s", qPrintable(label));
+                });
+
+                run(u"decode "_s + label, static_cast<quint64>(size), [&] {
+                    FixtureReply reply(bytes);
+                    handler->handleReply(query, *api.parseJson(&reply));
+                });
+            }
+
+            // Inputs of the helpers
+            const auto paging = search ? fixture[container].toObject() : fixture.object();
+            for (const auto &value : paging[u"items"_s].toArray())
+            {
+                auto item = value.toObject();
+                if (!search && item.contains(typeString(type)))  // saved item wrapper
+                    item = item[typeString(type)].toObject();
+
+                image_arrays.emplace_back(type == Track ? item[u"album"_s][u"images"_s].toArray()
+                                                        : item[u"images"_s].toArray());
+                if (type == Artist)
+                    artists.emplace_back(item);
+            }
+        }
+    }
+
+    run(u"pickImageUrl"_s, image_arrays.size(), [&] {
+        for (const auto &images : image_arrays)
+            pickImageUrl(images);
+    });
+
+    run(u"makeArtistDescription"_s, artists.size(), [&] {
+        for (const auto &artist : artists)
+            makeArtistDescription(artist);
+    });
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("\npeak resident set size: %ld KiB\n", usage.ru_maxrss);
+
+    return 0;
+}
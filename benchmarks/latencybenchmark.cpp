@@ -0,0 +1,135 @@
+// Copyright (c) 2026 Manuel Schneider
+
+// End-to-end latency of the query path against the local mock server. Types the queries key by
+// key, each keystroke starts a session fetching pages like items() until the next keystroke
+// invalidates it. Reports time to first item, page latencies and request counts.
+//
+// Usage: spotify_latency_benchmark --help
+
+#include "api.h"
+#include "handlers.h"
+#include "library.h"
+#include "mockserver.h"
+#include "sessiondriver.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QCoroTask>
+#include <QCoroTimer>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+namespace
+{
+
+const QStringList default_queries{
+    u"night river"_s,
+    u"golden"_s,
+    u"velvet lights"_s,
+    u"ocean city"_s,
+    u"neon dream"_s
+};
+
+struct Options
+{
+    QStringList queries;
+    uint pages;
+    chrono::milliseconds keystroke_interval;
+};
+
+QCoro::Task<> type(SpotifySearchHandler &handler, const Options &options, SessionStats &stats)
+{
+    vector<QCoro::Task<>> superseded;
+    auto alive = make_shared<bool>(false);
+
+    for (const auto &query : options.queries)
+        for (qsizetype length = 1; length <= query.size(); ++length)
+        {
+            *alive = false;
+            alive = make_shared<bool>(true);
+
+            if (length < query.size())
+            {
+                superseded.emplace_back(runSession(handler, query.left(length), options.pages, alive, stats));
+                co_await QCoro::sleepFor(options.keystroke_interval);
+            }
+            else  // the user reads the results
+                co_await runSession(handler, query, options.pages, alive, stats);
+        }
+
+    for (auto &task : superseded)
+        co_await ::move(task);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(u"End-to-end query latency against the local mock server."_s);
+    parser.addHelpOption();
+    const QCommandLineOption handler_option(u"handler"_s, u"Search handler id."_s, u"id"_s, u"track"_s);
+    const QCommandLineOption latency_option(u"latency"_s, u"Server latency."_s, u"ms"_s, u"50"_s);
+    const QCommandLineOption jitter_option(u"jitter"_s, u"Uniform server latency jitter."_s, u"ms"_s, u"20"_s);
+    const QCommandLineOption rate_limit_option(u"rate-limit"_s,
+                                               u"Requests per second the server accepts, 0 for any."_s,
+                                               u"n"_s, u"0"_s);
+    const QCommandLineOption interval_option(u"keystroke-interval"_s, u"Time between keystrokes."_s,
+                                             u"ms"_s, u"120"_s);
+    const QCommandLineOption pages_option(u"pages"_s, u"Pages fetched per session at most."_s,
+                                          u"n"_s, u"3"_s);
+    const QCommandLineOption fixtures_option(u"fixtures"_s, u"Fixtures directory."_s, u"dir"_s,
+                                             QStringLiteral(FIXTURES_DIR));
+    parser.addOptions({handler_option, latency_option, jitter_option, rate_limit_option,
+                       interval_option, pages_option, fixtures_option});
+    parser.addPositionalArgument(u"queries"_s, u"Queries to type."_s, u"[queries...]"_s);
+    parser.process(app);
+
+    MockServer server{QDir(parser.value(fixtures_option))};
+    server.setLatency(chrono::milliseconds(parser.value(latency_option).toInt()),
+                      chrono::milliseconds(parser.value(jitter_option).toInt()));
+    server.setRateLimit(parser.value(rate_limit_option).toUInt());
+    if (!server.listen())
+        qFatal("Failed to start the mock server.");
+
+    API api;
+    api.setApiUrl(server.url());
+    api.setAccountsUrl(server.url());
+    api.prefetcher.setEnabled(false);  // artwork downloads need the launcher
+
+    Library library(api);  // not loaded
+    const auto handlers = makeHandlers(api, library);
+
+    const auto it = ranges::find_if(handlers, [&](const auto &h) {
+        return h->id() == parser.value(handler_option);
+    });
+    if (it == handlers.end())
+        qFatal("Unknown handler %s.", qPrintable(parser.value(handler_option)));
+
+    Options options{
+        .queries = parser.positionalArguments().isEmpty() ? default_queries
+                                                          : parser.positionalArguments(),
+        .pages = parser.value(pages_option).toUInt(),
+        .keystroke_interval = chrono::milliseconds(parser.value(interval_option).toInt())
+    };
+
+    SessionStats stats;
+    QCoro::connect(type(**it, options, stats), &app, [&] {
+        printf("handler %s, latency %s+%s ms, rate limit %s/s, keystroke interval %s ms\n\n",
+               qPrintable((*it)->id()),
+               qPrintable(parser.value(latency_option)),
+               qPrintable(parser.value(jitter_option)),
+               qPrintable(parser.value(rate_limit_option)),
+               qPrintable(parser.value(interval_option)));
+
+        printReport(stats, api, server);
+        QMetaObject::invokeMethod(&app, &QCoreApplication::quit, Qt::QueuedConnection);
+    });
+
+    return app.exec();
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2026 Manuel Schneider
+
+// Benchmark of the local library scan over synthetic libraries of 10k, 100k and 1M records.
+// Scores the keys of a mapped library file like Library::match and reports scored records per
+// second for the matcher kernel and for QStringView::indexOf as baseline.
+//
+// Usage: spotify_matcher_benchmark [milliseconds per benchmark]
+
+#include "libraryfile.h"
+#include "matcher.h"
+#include "normalize.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QStringTokenizer>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+namespace
+{
+
+const QStringList vocabulary{
+    u"night"_s, u"river"_s, u"golden"_s, u"velvet"_s, u"lights"_s, u"ocean"_s, u"city"_s,
+    u"neon"_s, u"dream"_s, u"summer"_s, u"echo"_s, u"silver"_s, u"heart"_s, u"midnight"_s,
+    u"fire"_s, u"storm"_s, u"paradise"_s, u"electric"_s, u"shadow"_s, u"wild"_s, u"blue"_s,
+    u"forever"_s, u"love"_s, u"road"_s, u"sky"_s, u"après"_s, u"Straße"_s, u"東京"_s
+};
+
+const QStringList queries{
+    u"night"_s, u"gold riv"_s, u"velvet lights"_s, u"ocean city dream"_s, u"apres"_s,
+    u"strasse"_s, u"zzz"_s
+};
+
+chrono::milliseconds budget{500};
+
+QString randomWords(QRandomGenerator &random, int min_words, int max_words)
+{
+    QStringList words;
+    for (auto n = random.bounded(min_words, max_words + 1); n > 0; --n)
+        words << vocabulary[random.bounded(static_cast<int>(vocabulary.size()))];
+    return words.join(QChar::Space);
+}
+
+// Writes a library of n track records, in collections of 100 like playlists.
+bool writeLibrary(const QString &path, quint32 n)
+{
+    QRandomGenerator random(n);
+    vector<QString> strings;  // must outlive write()
+    strings.reserve(n * 4 + n / 100 + 1);
+
+    LibraryFile::Writer writer;
+    for (quint32 i = 0; i < n; ++i)
+    {
+        if (i % 100 == 0)
+        {
+            const auto &id = strings.emplace_back(u"playlist:%1"_s.arg(i / 100));
+            writer.addCollection(id, id, 100);
+        }
+
+        const auto &id = strings.emplace_back(u"track%1"_s.arg(i));
+        const auto &name = strings.emplace_back(randomWords(random, 1, 4));
+        const auto &description = strings.emplace_back(randomWords(random, 1, 2));
+        const auto &key = strings.emplace_back(normalizeSearchKey(name + QChar::Space + description));
+        writer.addRecord({id, name, description, {}, key});
+    }
+
+    return writer.write(path);
+}
+
+template<class Score>
+void run(const char *name, const LibraryFile &file, Score &&score)
+{
+    static constexpr size_t limit = 10;
+
+    // Per query the top k of all records, the scan of Library::match
+    const auto scan = [&](span<const QStringView> words) {
+        vector<int> top;
+        for (const auto &r : file.records())
+            if (const auto s = score(file.string(r.key), words);
+                s >= 0 && (top.size() < limit || s > top.front()))
+            {
+                if (top.size() == limit)
+                {
+                    ranges::pop_heap(top, greater{});
+                    top.pop_back();
+                }
+                top.push_back(s);
+                ranges::push_heap(top, greater{});
+            }
+        return top.size();
+    };
+
+    vector<QString> normalized;
+    vector<vector<QStringView>> words;
+    for (const auto &query : queries)
+        normalized.emplace_back(normalizeSearchKey(query));
+    for (const auto &query : normalized)
+    {
+        auto &w = words.emplace_back();
+        for (const auto word : QStringTokenizer(query, QChar::Space, Qt::SkipEmptyParts))
+            w.emplace_back(word);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    quint64 scans = 0;
+    size_t matches = 0;
+    do {
+        for (const auto &w : words)
+            matches += scan(w);
+        scans += words.size();
+    } while (!timer.hasExpired(budget.count()));
+
+    const auto ns = static_cast<double>(timer.nsecsElapsed());
+    const auto records = static_cast<double>(scans * file.records().size());
+    printf("%-10s %10zu %14.0f %12.1f %12.2f\n",
+           name, file.records().size(), records * 1e9 / ns, static_cast<double>(scans) * 1e9 / ns,
+           ns / 1e6 / static_cast<double>(scans));
+    (void)matches;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    if (const auto args = app.arguments(); args.size() > 1)
+        budget = chrono::milliseconds(args[1].toLongLong());
+
+    QTemporaryDir dir;
+    if (!dir.isValid())
+        qFatal("Failed creating a temporary directory.");
+
+    printf("kernel: %s\n\n", matcher::kernel());
+    printf("%-10s %10s %14s %12s %12s\n", "matcher", "records", "records/s", "queries/s", "ms/query");
+
+    for (const quint32 n : {10'000u, 100'000u, 1'000'000u})
+    {
+        const auto path = dir.filePath(u"library%1.bin"_s.arg(n));
+        LibraryFile file;
+        if (!writeLibrary(path, n) || !file.open(path))
+            qFatal("Failed writing the library of %u records.", n);
+
+        run(matcher::kernel(), file, matcher::score);
+
+        // Same scoring on top of the Qt substring search
+        run("qt", file, [](QStringView key, span<const QStringView> words) {
+            int score = 0;
+            for (const auto &word : words)
+                if (const auto pos = key.indexOf(word); pos < 0)
+                    return -1;
+                else
+                    score += pos == 0 ? 3 : key[pos - 1] == QChar::Space ? 2 : 1;
+            return score * 1024 - static_cast<int>(min<qsizetype>(key.size(), 1023));
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "mockserver.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrlQuery>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+static const qint64 rate_limit_window = 1000;  // ms
+static const int default_limit = 20;
+
+static QByteArray reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    default: return "Unknown";
+    }
+}
+
+// Error layout of the Web API
+static MockServer::Response error(int status, const QString &message)
+{
+    const QJsonObject body{{u"error"_s, QJsonObject{{u"status"_s, status}, {u"message"_s, message}}}};
+    return {status, QJsonDocument(body).toJson(QJsonDocument::Compact)};
+}
+
+MockServer::MockServer(const QDir &fixtures) :
+    fixtures_(fixtures)
+{
+    clock_.start();
+
+    connect(&server_, &QTcpServer::newConnection, this, [this] {
+        while (auto *socket = server_.nextPendingConnection())
+        {
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket] { onReadyRead(socket); });
+            connect(socket, &QTcpSocket::disconnected, this, [this, socket] {
+                buffers_.erase(socket);
+                socket->deleteLater();  // cancels delayed responses
+            });
+        }
+    });
+}
+
+bool MockServer::listen(quint16 port) { return server_.listen(QHostAddress::LocalHost, port); }
+
+QUrl MockServer::url() const { return QUrl(u"http://127.0.0.1:%1"_s.arg(server_.serverPort())); }
+
+void MockServer::setLatency(chrono::milliseconds latency, chrono::milliseconds jitter)
+{
+    latency_ = latency;
+    jitter_ = jitter;
+}
+
+void MockServer::setRateLimit(uint requests_per_second) { rate_limit_ = requests_per_second; }
+
+void MockServer::setHandler(const QString &path, Handler handler) { handlers_[path] = ::move(handler); }
+
+quint64 MockServer::requestCount() const { return requests_; }
+
+quint64 MockServer::rateLimitedCount() const { return rate_limited_; }
+
+void MockServer::onReadyRead(QTcpSocket *socket)
+{
+    auto &buffer = buffers_[socket];
+    buffer += socket->readAll();
+
+    for (qsizetype end; (end = buffer.indexOf("\r\n\r\n")) >= 0;)
+    {
+        const auto lines = buffer.left(end).split('\n');
+
+        qsizetype content_length = 0;
+        for (qsizetype i = 1; i < lines.size(); ++i)
+            if (const auto colon = lines[i].indexOf(':');
+                colon > 0 && lines[i].left(colon).trimmed().toLower() == "content-length")
+                content_length = lines[i].mid(colon + 1).trimmed().toLongLong();
+
+        if (buffer.size() < end + 4 + content_length)
+            return;  // body incomplete
+        buffer.remove(0, end + 4 + content_length);
+
+        const auto request_line = lines.first().trimmed().split(' ');
+        if (request_line.size() < 2)
+        {
+            socket->disconnectFromHost();
+            return;
+        }
+        const auto &method = request_line[0];
+        const auto url = QUrl(QString::fromLatin1(request_line[1]));
+
+        ++requests_;
+
+        const auto now = clock_.elapsed();
+        while (!recent_requests_.empty() && now - recent_requests_.front() >= rate_limit_window)
+            recent_requests_.pop_front();
+        recent_requests_.push_back(now);
+
+        Response response;
+        if (rate_limit_ && recent_requests_.size() > rate_limit_)
+        {
+            ++rate_limited_;
+            response = error(429, u"API rate limit exceeded"_s);
+            response.headers["Retry-After"] = "1";
+        }
+        else
+            response = respond(method, url);
+
+        QByteArray data = "HTTP/1.1 " + QByteArray::number(response.status) + ' '
+                          + reasonPhrase(response.status) + "\r\n";
+        data += "Content-Type: application/json; charset=utf-8\r\n";
+        data += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+        for (const auto &[name, value] : response.headers)
+            data += name + ": " + value + "\r\n";
+        data += "\r\n" + response.body;
+
+        auto delay = latency_;
+        if (jitter_.count() > 0)
+            delay += chrono::milliseconds(
+                QRandomGenerator::global()->bounded(static_cast<qint64>(jitter_.count()) + 1));
+        QTimer::singleShot(delay, socket, [socket, data] { socket->write(data); });
+    }
+}
+
+MockServer::Response MockServer::respond(const QByteArray &method, const QUrl &url)
+{
+    const auto path = url.path();
+    const QUrlQuery query(url);
+
+    if (const auto it = handlers_.find(path); it != handlers_.end())
+        return it->second(method, url);
+
+    if (method == "POST" && path == "/api/token"_L1)
+        return {200, R"({"access_token":"mock","token_type":"Bearer","expires_in":3600,"refresh_token":"mock"})"};
+
+    if (method != "GET")  // playback control
+        return {204, {}};
+
+    if (path == "/v1/me"_L1)
+        return {200, R"({"id":"mock","display_name":"Mock","product":"premium","type":"user"})"};
+
+    if (path == "/v1/search"_L1)
+    {
+        const auto type = query.queryItemValue(u"type"_s);
+        return page(u"search_"_s + type, type + u's', query);
+    }
+
+    static const map<QString, QString> library_fixtures{
+        {u"/v1/me/top/tracks"_s, u"library_track"_s},
+        {u"/v1/me/top/artists"_s, u"library_artist"_s},
+        {u"/v1/me/albums"_s, u"library_album"_s},
+        {u"/v1/me/playlists"_s, u"library_playlist"_s},
+        {u"/v1/me/shows"_s, u"library_show"_s},
+        {u"/v1/me/episodes"_s, u"library_episode"_s},
+        {u"/v1/me/audiobooks"_s, u"library_audiobook"_s}
+    };
+    if (const auto it = library_fixtures.find(path); it != library_fixtures.end())
+        return page(it->second, {}, query);
+
+    // Saved tracks and playlist items wrap the tracks
+    if (path == "/v1/me/tracks"_L1 || (path.startsWith("/v1/playlists/"_L1) && path.endsWith("/tracks"_L1)))
+        return page(u"library_track"_s, {}, query, true);
+
+    return error(404, u"Not found"_s);
+}
+
+MockServer::Response MockServer::page(const QString &name, const QString &container,
+                                      const QUrlQuery &query, bool wrap_tracks)
+{
+    const auto &doc = fixture(name);
+    if (doc.isNull())
+        return error(404, u"No fixture %1"_s.arg(name));
+
+    const auto all = (container.isNull() ? doc.object() : doc[container].toObject())[u"items"_s].toArray();
+    const auto total = static_cast<int>(all.size());
+    const auto limit = query.hasQueryItem(u"limit"_s) ? query.queryItemValue(u"limit"_s).toInt()
+                                                      : default_limit;
+    const auto offset = query.queryItemValue(u"offset"_s).toInt();
+
+    QJsonArray items;
+    for (auto i = offset; i < min(offset + limit, total); ++i)
+        if (wrap_tracks)
+            items.append(QJsonObject{{u"added_at"_s, u"2020-01-01T00:00:00Z"_s}, {u"track"_s, all[i]}});
+        else
+            items.append(all[i]);
+
+    const QJsonObject paging{
+        {u"items"_s, items},
+        {u"limit"_s, limit},
+        {u"offset"_s, offset},
+        {u"total"_s, total}
+    };
+
+    const auto body = container.isNull() ? paging : QJsonObject{{container, paging}};
+    return {200, QJsonDocument(body).toJson(QJsonDocument::Compact)};
+}
+
+const QJsonDocument &MockServer::fixture(const QString &name)
+{
+    if (const auto it = fixture_cache_.find(name); it != fixture_cache_.end())
+        return it->second;
+
+    QJsonDocument doc;
+    if (QFile file(fixtures_.filePath(name + u".json"_s)); file.open(QIODevice::ReadOnly))
+        doc = QJsonDocument::fromJson(file.readAll());
+    return fixture_cache_.emplace(name, doc).first->second;
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QByteArray>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QObject>
+#include <QTcpServer>
+#include <QUrl>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+class QTcpSocket;
+class QUrlQuery;
+
+// Local stand-in for the Spotify Web API and accounts service.
+//
+// Minimal HTTP/1.1 server serving the fixtures paged by limit and offset. Responses can be
+// overridden per path, delayed and rate limited.
+class MockServer : public QObject
+{
+public:
+
+    struct Response
+    {
+        int status = 200;
+        QByteArray body;
+        std::map<QByteArray, QByteArray> headers = {};
+    };
+
+    using Handler = std::function<Response(const QByteArray &method, const QUrl &url)>;
+
+    explicit MockServer(const QDir &fixtures);
+
+    bool listen(quint16 port = 0);
+    [[nodiscard]] QUrl url() const;
+
+    // Delays each response by latency plus a uniformly distributed jitter.
+    void setLatency(std::chrono::milliseconds latency, std::chrono::milliseconds jitter = {});
+
+    // Responds 429 once more than the given number of requests arrived within a second,
+    // 0 disables rate limiting.
+    void setRateLimit(uint requests_per_second);
+
+    // Overrides the response for a path.
+    void setHandler(const QString &path, Handler);
+
+    [[nodiscard]] quint64 requestCount() const;
+    [[nodiscard]] quint64 rateLimitedCount() const;
+
+private:
+
+    void onReadyRead(QTcpSocket *);
+    Response respond(const QByteArray &method, const QUrl &url);
+    Response page(const QString &fixture, const QString &container, const QUrlQuery &,
+                  bool wrap_tracks = false);
+    const QJsonDocument &fixture(const QString &name);
+
+    QTcpServer server_;
+    QDir fixtures_;
+    std::map<QString, QJsonDocument> fixture_cache_;
+    std::map<QString, Handler> handlers_;
+    std::map<QTcpSocket*, QByteArray> buffers_;
+    std::chrono::milliseconds latency_{0};
+    std::chrono::milliseconds jitter_{0};
+    uint rate_limit_ = 0;
+    QElapsedTimer clock_;
+    std::deque<qint64> recent_requests_;  // arrival times within the last second
+    quint64 requests_ = 0;
+    quint64 rate_limited_ = 0;
+
+};
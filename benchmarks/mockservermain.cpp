@@ -0,0 +1,43 @@
+// Copyright (c) 2026 Manuel Schneider
+
+// Serves the fixtures like the Web API, e.g. to run the launcher against it.
+//
+// Usage: spotify_mock_server --help
+
+#include "mockserver.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <cstdio>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(u"Local stand-in for the Spotify Web API."_s);
+    parser.addHelpOption();
+    const QCommandLineOption port_option(u"port"_s, u"Port, 0 for any."_s, u"port"_s, u"0"_s);
+    const QCommandLineOption latency_option(u"latency"_s, u"Response latency."_s, u"ms"_s, u"50"_s);
+    const QCommandLineOption jitter_option(u"jitter"_s, u"Uniform latency jitter."_s, u"ms"_s, u"20"_s);
+    const QCommandLineOption rate_limit_option(u"rate-limit"_s,
+                                               u"Requests per second accepted, 0 for any."_s,
+                                               u"n"_s, u"0"_s);
+    const QCommandLineOption fixtures_option(u"fixtures"_s, u"Fixtures directory."_s, u"dir"_s,
+                                             QStringLiteral(FIXTURES_DIR));
+    parser.addOptions({port_option, latency_option, jitter_option, rate_limit_option, fixtures_option});
+    parser.process(app);
+
+    MockServer server{QDir(parser.value(fixtures_option))};
+    server.setLatency(chrono::milliseconds(parser.value(latency_option).toInt()),
+                      chrono::milliseconds(parser.value(jitter_option).toInt()));
+    server.setRateLimit(parser.value(rate_limit_option).toUInt());
+    if (!server.listen(static_cast<quint16>(parser.value(port_option).toUInt())))
+        qFatal("Failed to listen on port %s.", qPrintable(parser.value(port_option)));
+
+    printf("Listening on %s\n", qPrintable(server.url().toString()));
+    fflush(stdout);
+
+    return app.exec();
+}
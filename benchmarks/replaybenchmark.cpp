@@ -0,0 +1,177 @@
+// Copyright (c) 2026 Manuel Schneider
+
+// Replays a recorded session file against the local mock server. Starts the recorded queries at
+// their recorded times, each query invalidates the previous one of its handler, and fetches as
+// many pages as the recorded session did. Reports the replayed latencies next to the recorded ones.
+//
+// Record sessions by setting `record_sessions` to `true` in the plugin settings.
+//
+// Usage: spotify_replay_benchmark --help
+
+#include "api.h"
+#include "handlers.h"
+#include "library.h"
+#include "mockserver.h"
+#include "sessiondriver.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QCoroTask>
+#include <QCoroTimer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <vector>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+namespace
+{
+
+struct RecordedSession
+{
+    QString handler;
+    QString query;
+    qint64 t;        // ms since the recording started
+    uint pages = 1;  // fetched or invalidated
+};
+
+struct Recording
+{
+    vector<RecordedSession> sessions;  // by start time
+    vector<qint64> page_ns;            // recorded page fetch times
+};
+
+Recording readRecording(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        qFatal("Failed to open %s: %s", qPrintable(path), qPrintable(file.errorString()));
+
+    Recording recording;
+    map<pair<QString, qint64>, size_t> index;  // (handler, qid) to session
+    while (!file.atEnd())
+    {
+        const auto event = QJsonDocument::fromJson(file.readLine()).object();
+        const auto type = event[u"event"_s].toString();
+        const auto key = pair{event[u"handler"_s].toString(), event[u"qid"_s].toInteger()};
+
+        if (type == u"query"_s)
+        {
+            index[key] = recording.sessions.size();
+            recording.sessions.push_back({.handler = key.first,
+                                          .query = event[u"query"_s].toString(),
+                                          .t = event[u"t"_s].toInteger()});
+        }
+        else if (type == u"page"_s || type == u"invalidated"_s)
+        {
+            if (const auto it = index.find(key); it != index.end())
+            {
+                auto &session = recording.sessions[it->second];
+                session.pages = max(session.pages, static_cast<uint>(event[u"page"_s].toInt()) + 1);
+            }
+            if (type == u"page"_s && event[u"ok"_s].toBool())
+                recording.page_ns.emplace_back(event[u"ms"_s].toInteger() * 1'000'000);
+        }
+    }
+
+    ranges::stable_sort(recording.sessions, {}, &RecordedSession::t);
+    return recording;
+}
+
+QCoro::Task<> replay(const vector<unique_ptr<SpotifySearchHandler>> &handlers,
+                     const Recording &recording, double speed, SessionStats &stats)
+{
+    vector<QCoro::Task<>> sessions;
+    map<QString, shared_ptr<bool>> alive;  // latest session per handler
+
+    QElapsedTimer clock;
+    clock.start();
+
+    for (const auto &session : recording.sessions)
+    {
+        const auto it = ranges::find_if(handlers, [&](const auto &h) { return h->id() == session.handler; });
+        if (it == handlers.end())
+            continue;  // e.g. the library handler, local only
+
+        if (const auto due = static_cast<qint64>(static_cast<double>(session.t) / speed) - clock.elapsed();
+            due > 0)
+            co_await QCoro::sleepFor(chrono::milliseconds(due));
+
+        auto &latest = alive[session.handler];
+        if (latest)
+            *latest = false;
+        latest = make_shared<bool>(true);
+
+        sessions.emplace_back(runSession(**it, session.query, session.pages, latest, stats));
+    }
+
+    for (auto &task : sessions)
+        co_await ::move(task);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(u"Replays a recorded session file against the local mock server."_s);
+    parser.addHelpOption();
+    const QCommandLineOption speed_option(u"speed"_s, u"Replay speed factor."_s, u"factor"_s, u"1"_s);
+    const QCommandLineOption latency_option(u"latency"_s, u"Server latency."_s, u"ms"_s, u"50"_s);
+    const QCommandLineOption jitter_option(u"jitter"_s, u"Uniform server latency jitter."_s, u"ms"_s, u"20"_s);
+    const QCommandLineOption rate_limit_option(u"rate-limit"_s,
+                                               u"Requests per second the server accepts, 0 for any."_s,
+                                               u"n"_s, u"0"_s);
+    const QCommandLineOption fixtures_option(u"fixtures"_s, u"Fixtures directory."_s, u"dir"_s,
+                                             QStringLiteral(FIXTURES_DIR));
+    parser.addOptions({speed_option, latency_option, jitter_option, rate_limit_option, fixtures_option});
+    parser.addPositionalArgument(u"recording"_s, u"Session file, e.g. from the spotify/sessions cache."_s);
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    const auto recording = readRecording(parser.positionalArguments().first());
+    const auto speed = parser.value(speed_option).toDouble();
+    if (speed <= 0)
+        qFatal("Invalid speed factor.");
+
+    MockServer server{QDir(parser.value(fixtures_option))};
+    server.setLatency(chrono::milliseconds(parser.value(latency_option).toInt()),
+                      chrono::milliseconds(parser.value(jitter_option).toInt()));
+    server.setRateLimit(parser.value(rate_limit_option).toUInt());
+    if (!server.listen())
+        qFatal("Failed to start the mock server.");
+
+    API api;
+    api.setApiUrl(server.url());
+    api.setAccountsUrl(server.url());
+    api.prefetcher.setEnabled(false);  // artwork downloads need the launcher
+
+    Library library(api);  // not loaded
+    const auto handlers = makeHandlers(api, library);
+
+    SessionStats stats;
+    QCoro::connect(replay(handlers, recording, speed, stats), &app, [&] {
+        printf("%zu recorded sessions, speed %gx, latency %s+%s ms, rate limit %s/s\n\n",
+               recording.sessions.size(), speed,
+               qPrintable(parser.value(latency_option)),
+               qPrintable(parser.value(jitter_option)),
+               qPrintable(parser.value(rate_limit_option)));
+
+        printf("recorded pages      p50 %8.1f ms  p99 %8.1f ms  n %zu\n",
+               percentileMs(recording.page_ns, .5), percentileMs(recording.page_ns, .99),
+               recording.page_ns.size());
+        printReport(stats, api, server);
+        QMetaObject::invokeMethod(&app, &QCoreApplication::quit, Qt::QueuedConnection);
+    });
+
+    return app.exec();
+}
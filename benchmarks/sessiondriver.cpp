@@ -0,0 +1,92 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "api.h"
+#include "handlers.h"
+#include "mockserver.h"
+#include "sessiondriver.h"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstdio>
+using namespace std;
+
+vector<unique_ptr<SpotifySearchHandler>> makeHandlers(API &api, const Library &library)
+{
+    vector<unique_ptr<SpotifySearchHandler>> handlers;
+    handlers.emplace_back(make_unique<TrackSearchHandler>(api, library));
+    handlers.emplace_back(make_unique<ArtistSearchHandler>(api));
+    handlers.emplace_back(make_unique<AlbumSearchHandler>(api));
+    handlers.emplace_back(make_unique<PlaylistSearchHandler>(api));
+    handlers.emplace_back(make_unique<ShowSearchHandler>(api));
+    handlers.emplace_back(make_unique<EpisodeSearchHandler>(api));
+    handlers.emplace_back(make_unique<AudiobookSearchHandler>(api));
+    return handlers;
+}
+
+QCoro::Task<> runSession(SpotifySearchHandler &handler, QString query, uint pages,
+                         shared_ptr<bool> alive, SessionStats &stats)
+{
+    ++stats.sessions;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (uint page = 0; page < pages; ++page)
+    {
+        QElapsedTimer page_timer;
+        page_timer.start();
+
+        ++stats.fetches;
+        const auto exp_items = co_await handler.fetchPage(query, page, [alive] { return *alive; });
+
+        if (!*alive)
+        {
+            ++stats.invalidated;
+            co_return;
+        }
+
+        if (!exp_items)
+        {
+            ++stats.errors;
+            stats.last_error = exp_items.error();
+            co_return;
+        }
+
+        stats.page_ns.emplace_back(page_timer.nsecsElapsed());
+        if (page == 0)
+            stats.first_item_ns.emplace_back(timer.nsecsElapsed());
+
+        if (exp_items->empty())
+            co_return;
+    }
+}
+
+double percentileMs(vector<qint64> v, double q)
+{
+    if (v.empty())
+        return 0;
+    ranges::sort(v);
+    return static_cast<double>(v[static_cast<size_t>(q * static_cast<double>(v.size() - 1) + .5)]) / 1e6;
+}
+
+void printReport(const SessionStats &stats, const API &api, const MockServer &server)
+{
+    printf("sessions            %llu (%llu invalidated, %llu failed)\n",
+           stats.sessions, stats.invalidated, stats.errors);
+    printf("time to first item  p50 %8.1f ms  p99 %8.1f ms  n %zu\n",
+           percentileMs(stats.first_item_ns, .5), percentileMs(stats.first_item_ns, .99),
+           stats.first_item_ns.size());
+    printf("page latency        p50 %8.1f ms  p99 %8.1f ms  n %zu\n",
+           percentileMs(stats.page_ns, .5), percentileMs(stats.page_ns, .99),
+           stats.page_ns.size());
+
+    quint64 deduplicated = 0;
+    for (const auto &[endpoint, counters] : api.metrics.counters())
+        deduplicated += counters[static_cast<size_t>(Metrics::Counter::Deduplicated)];
+    printf("requests            %llu page fetches, %llu deduplicated, %llu sent, %llu rate limited\n",
+           stats.fetches, deduplicated, server.requestCount(), server.rateLimitedCount());
+
+    if (!stats.last_error.isEmpty())
+        printf("last error          %s\n", qPrintable(stats.last_error));
+
+    printf("\n%s\n", qPrintable(api.metrics.report()));
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QCoroTask>
+#include <QString>
+#include <memory>
+#include <vector>
+class API;
+class Library;
+class MockServer;
+class SpotifySearchHandler;
+
+// Outcomes and latencies of driven query sessions.
+struct SessionStats
+{
+    std::vector<qint64> first_item_ns;
+    std::vector<qint64> page_ns;
+    quint64 sessions = 0;
+    quint64 invalidated = 0;
+    quint64 errors = 0;
+    quint64 fetches = 0;
+    QString last_error;
+};
+
+// The search handlers in the order of SearchType.
+std::vector<std::unique_ptr<SpotifySearchHandler>> makeHandlers(API &, const Library &);
+
+// Fetches pages like items() until invalidated, past the last page or out of pages.
+//
+// Drives fetchPage, the page path of items(), since a QueryContext cannot be instantiated
+// outside the launcher.
+QCoro::Task<> runSession(SpotifySearchHandler &, QString query, uint pages,
+                         std::shared_ptr<bool> alive, SessionStats &);
+
+// The q-quantile in milliseconds, 0 if empty.
+double percentileMs(std::vector<qint64>, double q);
+
+// Prints the session outcomes, latencies, request counts and the endpoint metrics.
+void printReport(const SessionStats &, const API &, const MockServer &);
@@ -94,6 +94,34 @@
         <source>Add to queue</source>
         <translation type="vanished">Zur Warteschlange hinzufügen</translation>
     </message>
+    <message>
+        <source>Statistics</source>
+        <translation type="unfinished"></translation>
+    </message>
+    <message>
+        <source>Write to log</source>
+        <translation type="unfinished"></translation>
+    </message>
+    <message>
+        <source>Reset</source>
+        <translation type="unfinished"></translation>
+    </message>
+    <message>
+        <source>Save trace</source>
+        <translation type="unfinished"></translation>
+    </message>
+    <message>
+        <source>Export</source>
+        <translation type="unfinished"></translation>
+    </message>
+    <message>
+        <source>Spotify library</source>
+        <translation type="unfinished"></translation>
+    </message>
+    <message>
+        <source>Search the synced Spotify library</source>
+        <translation type="unfinished"></translation>
+    </message>
 </context>
 <context>
     <name>SpotifyItem</name>
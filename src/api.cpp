@@ -2,19 +2,27 @@
 
 #include "api.h"
 #include <QCoreApplication>
+#include <QCoroFuture>
+#include <QCoroNetworkReply>
+#include <QElapsedTimer>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QNetworkDiskCache>
 #include <QNetworkReply>
+#include <QScopeGuard>
 #include <QUrlQuery>
 #include <albert/logging.h>
 #include <albert/networkutil.h>
+#include <memory>
 using namespace Qt::StringLiterals;
 using namespace albert;
 using namespace std;
 
-static const auto oauth_auth_url = u"https://accounts.spotify.com/authorize"_s;
-static const auto oauth_token_url = u"https://accounts.spotify.com/api/token"_s;
+static const auto default_api_url = u"https://api.spotify.com"_s;
+static const auto default_accounts_url = u"https://accounts.spotify.com"_s;
+static const auto oauth_auth_path = u"/authorize"_s;
+static const auto oauth_token_path = u"/api/token"_s;
 static const auto oauth_scope = u"playlist-read-collaborative "_s
                                 u"playlist-read-private "_s
                                 u"user-follow-read "_s
@@ -23,6 +31,16 @@ static const auto oauth_scope = u"playlist-read-collaborative "_s
                                 u"user-read-private "_s
                                 u"user-top-read "_s
                                 u"user-library-read"_s;
+static const auto token_refresh_margin = 5min;  // refresh this long before expiration
+static const chrono::milliseconds token_refresh_retry = 1min;  // doubled per failure
+static const chrono::milliseconds max_token_refresh_retry = 1h;
+static const auto clock_check_interval = 1min;
+static const auto account_revalidation_delay = 1min;
+static const char *endpoint_property = "endpoint";
+static const qint64 http_cache_size = 20 * 1024 * 1024;
+static const auto market_from_token = u"from_token"_s;  // omits per-market availability arrays
+static const auto playlist_items_fields =
+    u"total,items(added_at,track(type,id,name,artists(name),album(images)))"_s;
 
 
 static const std::array<const char*, 7> type_strings {
@@ -50,24 +68,97 @@ QString localizedTypeString(SearchType type)
 
 // -------------------------------------------------------------------------------------------------
 
-API::API()
+API::API() :
+    api_url_(default_api_url),
+    token_refresh_retry_(token_refresh_retry),
+    metrics_handle_(&metrics, [](Metrics *) {})
 {
-    oauth.setAuthUrl(oauth_auth_url);
+    credentials_promise_.start();
+
+    setAccountsUrl(QUrl(default_accounts_url));
     oauth.setScope(oauth_scope);
-    oauth.setTokenUrl(oauth_token_url);
     oauth.setRedirectUri("%1://spotify/"_L1.arg(qApp->applicationName()));
     oauth.setPkceEnabled(true);
 
     QObject::connect(&oauth, &OAuth2::tokensChanged, &oauth, [this] {
         if (oauth.error().isEmpty())
+        {
             DEBG << "Tokens updated.";
-        else
+            token_refresh_retry_ = token_refresh_retry;
+            scheduleTokenRefresh();
+        }
+        else if (oauth.refreshToken().isEmpty())
             WARN << oauth.error();
+        else if (oauth.error().contains("invalid_grant"_L1))
+        {
+            // Revoked, e.g. the user removed the app access. Retrying does not help.
+            WARN << oauth.error() << "Log in again.";
+            token_refresh_timer_.stop();
+            token_refresh_retry_ = token_refresh_retry;
+            oauth.setTokens({}, {}, {});  // leaves the granted state, the settings offer to log in
+        }
+        else
+        {
+            WARN << oauth.error() << "Retrying in"
+                 << chrono::duration_cast<chrono::seconds>(token_refresh_retry_).count() << "s.";
+            token_refresh_timer_.start(token_refresh_retry_);
+            token_refresh_retry_ = min(token_refresh_retry_ * 2, max_token_refresh_retry);
+        }
     });
 
     QObject::connect(&oauth, &OAuth2::stateChanged, &oauth, [this] {
         updateAccountInformatoin();
     });
+
+    // Refresh tokens in the background, such that queries never wait for a token refresh.
+    token_refresh_timer_.setSingleShot(true);
+    QObject::connect(&token_refresh_timer_, &QTimer::timeout, &oauth, [this] {
+        DEBG << "Refreshing tokens.";
+        oauth.updateTokens();
+    });
+
+    // Timers are based on a monotonic clock that does not advance while the system sleeps.
+    // Watch the wall clock to detect resumes and reevaluate the token expiration.
+    last_clock_check_ = QDateTime::currentDateTime();
+    QObject::connect(&clock_check_timer_, &QTimer::timeout, &oauth, [this] { checkClock(); });
+    clock_check_timer_.start(clock_check_interval);
+}
+
+void API::setCacheDirectory(const QString &path)
+{
+    // Responses carry validators, cached ones are revalidated instead of downloaded again
+    auto *cache = new QNetworkDiskCache(&network_);
+    cache->setCacheDirectory(path);
+    cache->setMaximumCacheSize(http_cache_size);
+    network_.setCache(cache);  // takes ownership, deletes the previous one
+}
+
+void API::scheduleTokenRefresh()
+{
+    token_refresh_timer_.stop();
+
+    if (oauth.refreshToken().isEmpty() || !oauth.tokenExpiration().isValid())
+        return;
+
+    const auto remaining = chrono::milliseconds(
+        QDateTime::currentDateTime().msecsTo(oauth.tokenExpiration()));
+    const auto timeout = max(remaining - token_refresh_margin, chrono::milliseconds::zero());
+
+    DEBG << "Scheduled token refresh in" << chrono::duration_cast<chrono::seconds>(timeout).count() << "s.";
+    token_refresh_timer_.start(timeout);
+}
+
+void API::checkClock()
+{
+    const auto now = QDateTime::currentDateTime();
+
+    if (chrono::milliseconds(last_clock_check_.msecsTo(now)) > 2 * clock_check_interval)
+    {
+        DEBG << "Wall clock jumped, assuming resume from sleep.";
+        scheduleTokenRefresh();
+    }
+
+    last_clock_check_ = now;
 }
 
 void API::updateAccountInformatoin()
@@ -75,32 +166,90 @@ void API::updateAccountInformatoin()
     if (oauth.state() != OAuth2::State::Granted)
         return;
 
-    auto reply = userProfile();
+    // Cached information is good enough to start with. Revalidate later, off the query path.
+    if (account_information_restored_)
+    {
+        account_information_restored_ = false;
+        QTimer::singleShot(account_revalidation_delay, &oauth, [this] { updateAccountInformatoin(); });
+        return;
+    }
 
-    QObject::connect(reply, &QNetworkReply::finished, &oauth, [this, reply]  // use oauth as context to avoid having inherit qobject
+    // use oauth as context to avoid having inherit qobject
+    QCoro::connect(userProfile(), &oauth, [this](const expected<QJsonDocument, QString> &exp_doc)
     {
-        if (auto exp_doc = API::parseJson(reply); !exp_doc)
+        if (!exp_doc)
             WARN << "Failed fetching user profile:" << exp_doc.error();
         else
         {
             const auto &profile = *exp_doc;
 
-            username_ = profile["display_name"_L1].toString();
-            if (username_.isEmpty())
-                username_ = profile["id"_L1].toString();
+            auto username = profile["display_name"_L1].toString();
+            if (username.isEmpty())
+                username = profile["id"_L1].toString();
+            const auto product = profile["product"_L1].toString();
+
+            if (username == username_ && product == product_)
+                return;
+
+            username_ = username;
+            product_ = product;
+            is_premium_ = product_ == u"premium"_s;
             INFO << "Username:" << username_;
+            INFO << "Product type:" << product_;
 
-            const auto product_string = profile["product"_L1].toString();
-            is_premium_ = profile["product"_L1].toString() == u"premium"_s;
-            INFO << "Product type:" << product_string;
+            if (account_information_changed)
+                account_information_changed();
         }
     });
 }
 
+void API::restoreAccountInformation(const QString &username, const QString &product)
+{
+    if (username.isEmpty())
+        return;
+
+    username_ = username;
+    product_ = product;
+    is_premium_ = product_ == u"premium"_s;
+    account_information_restored_ = true;
+    DEBG << "Restored account information:" << username_ << product_;
+}
+
+const QUrl &API::apiUrl() const { return api_url_; }
+
+void API::setApiUrl(const QUrl &url)
+{
+    api_url_ = url.isValid() ? url.adjusted(QUrl::StripTrailingSlash) : QUrl(default_api_url);
+}
+
+void API::setAccountsUrl(const QUrl &url)
+{
+    const auto base = url.isValid() ? url.toString(QUrl::StripTrailingSlash) : default_accounts_url;
+    oauth.setAuthUrl(base + oauth_auth_path);
+    oauth.setTokenUrl(base + oauth_token_path);
+}
+
+QFuture<void> API::credentials() const { return credentials_promise_.future(); }
+
+void API::setCredentialsLoaded()
+{
+    if (!credentials_promise_.future().isFinished())
+        credentials_promise_.finish();
+}
+
 const QString &API::username() const { return username_; }
 
 bool API::isPremium() const { return is_premium_; }
 
+const QString &API::product() const { return product_; }
+
+void API::noteInteractive() { last_interactive_.start(); }
+
+weak_ptr<Metrics> API::weakMetrics() const { return metrics_handle_; }
+
+bool API::isIdle(chrono::milliseconds duration) const
+{ return !last_interactive_.isValid() || chrono::milliseconds(last_interactive_.elapsed()) >= duration; }
+
 // -------------------------------------------------------------------------------------------------
 
 expected<QJsonDocument, QString> API::parseJson(QNetworkReply *reply)
@@ -112,6 +261,7 @@ expected<QJsonDocument, QString> API::parseJson(QNetworkReply *reply)
     if (reply->error() == QNetworkReply::NoError) {
         if (parseError.error == QJsonParseError::NoError)
             return doc;
+        metrics.increment(reply->property(endpoint_property).toString(), Metrics::Counter::ParseErrors);
         return unexpected(u"JSON parse error: "_s + parseError.errorString());
     }
 
@@ -134,12 +284,14 @@ expected<QJsonDocument, QString> API::parseJson(QNetworkReply *reply)
 
 QNetworkRequest API::request(const QString &path, const QUrlQuery &query)
 {
-    QUrl url(u"https://api.spotify.com"_s);
-    url.setPath(path);
+    QUrl url(api_url_);
+    url.setPath(url.path() + path);
     url.setQuery(query);
 
     QNetworkRequest request(url);
     request.setRawHeader("Accept", "application/json");
+    // Do not set Accept-Encoding. QNetworkAccessManager negotiates the compressions it supports and
+    // decompresses transparently, but only if the header is not set manually.
     if (oauth.state() == OAuth2::State::Granted)
         request.setRawHeader("Authorization", "Bearer " + oauth.accessToken().toUtf8());
 
@@ -148,94 +300,283 @@ QNetworkRequest API::request(const QString &path, const QUrlQuery &query)
     return request;
 }
 
+QNetworkReply *API::instrument(QNetworkReply *reply, const QString &endpoint)
+{
+    struct Marks
+    {
+        QElapsedTimer timer;
+        qint64 connecting = -1;
+        qint64 sent = -1;
+        qint64 headers = -1;
+    };
+
+    auto marks = make_shared<Marks>();
+    marks->timer.start();
+
+    reply->setProperty(endpoint_property, endpoint);
+    metrics.increment(endpoint, Metrics::Counter::Requests);
+
+    QObject::connect(reply, &QNetworkReply::socketStartedConnecting, reply,
+                     [marks] { marks->connecting = marks->timer.nsecsElapsed(); });
+
+    QObject::connect(reply, &QNetworkReply::requestSent, reply,
+                     [marks] { marks->sent = marks->timer.nsecsElapsed(); });
+
+    QObject::connect(reply, &QNetworkReply::metaDataChanged, reply, [marks] {
+        if (marks->headers < 0)
+            marks->headers = marks->timer.nsecsElapsed();
+    });
+
+    QObject::connect(reply, &QNetworkReply::finished, reply, [this, reply, endpoint, marks] {
+        using enum Metrics::Stage;
+        using enum Metrics::Counter;
+        using ns = chrono::nanoseconds;
+        const auto finished = marks->timer.nsecsElapsed();
+
+        metrics.increment(endpoint, Bytes, static_cast<quint64>(reply->bytesAvailable()));
+        if (reply->operation() == QNetworkAccessManager::GetOperation)
+            metrics.addCacheLookup(u"http"_s,
+                                   reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool());
+        if (const auto length = reply->header(QNetworkRequest::ContentLengthHeader); length.isValid())
+            metrics.increment(endpoint, WireBytes, length.toULongLong());
+
+        if (const auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+            !status.isValid())
+            metrics.increment(endpoint, NetworkErrors);
+        else if (const auto code = status.toInt(); code == 401)
+            metrics.increment(endpoint, Unauthorized);
+        else if (code == 429)
+            metrics.increment(endpoint, RateLimited);
+        else if (code >= 500)
+            metrics.increment(endpoint, ServerErrors);
+        else if (code >= 400)
+            metrics.increment(endpoint, ClientErrors);
+
+        // Stages stay unset if the reply failed early, e.g. on DNS errors
+        if (marks->sent >= 0)  // no connection setup on reused connections
+            metrics.addEndpointTiming(endpoint, Connect,
+                                      ns(marks->connecting < 0 ? 0 : marks->sent - marks->connecting));
+        if (marks->sent >= 0 && marks->headers >= 0)
+            metrics.addEndpointTiming(endpoint, ServerWait, ns(marks->headers - marks->sent));
+        if (marks->headers >= 0)
+            metrics.addEndpointTiming(endpoint, Download, ns(finished - marks->headers));
+        metrics.addEndpointTiming(endpoint, Total, ns(finished));
+    });
+
+    return reply;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+API::Reply API::get(QString path, QUrlQuery query, QString endpoint, Validator valid,
+                    DiagnosticsPtr diagnostics)
+{
+    using enum Metrics::Stage;
+    using ns = chrono::nanoseconds;
+    using Result = expected<QJsonDocument, QString>;
+
+    endpoint = u"GET "_s + (endpoint.isNull() ? path : endpoint);
+    const auto key = path + u'?' + query.toString(QUrl::FullyEncoded);
+    if (!diagnostics)
+        diagnostics = make_shared<Diagnostics>();
+
+    // Background requests have no lane and may overlap
+    const auto span = [this, &diagnostics](const char *name) {
+        return diagnostics->trace_pid
+                   ? tracer.span(name, diagnostics->trace_pid, diagnostics->trace_tid)
+                   : tracer.asyncSpan(name, 0);
+    };
+
+    // Join an identical request in flight
+    if (const auto it = flights_.find(key); it != flights_.end())
+    {
+        ++it->second.callers;
+        metrics.increment(endpoint, Metrics::Counter::Deduplicated);
+        auto result = it->second.result;  // the flight is removed on completion
+        const auto joined = it->second.diagnostics;
+        auto join_span = span("joined");
+        auto r = co_await result;
+        join_span.end();
+        diagnostics->status = joined->status;
+        diagnostics->bytes = joined->bytes;
+        diagnostics->parse_ns = joined->parse_ns;
+        co_return r;
+    }
+
+    // Do not take a limiter slot for requests cancelled already, e.g. background requests
+    if (valid && !valid())
+        co_return unexpected(u"Request cancelled."_s);
+
+    QPromise<Result> promise;
+    promise.start();
+    flights_.emplace(key, Flight{promise.future(), diagnostics, 1});
+
+    QElapsedTimer timer;
+    timer.start();
+    auto limiter_span = span("limiter");
+    metrics.addToGauge(u"limiter waiters"_s, 1);
+    {
+        // Also if the coroutine is destroyed while waiting
+        const auto waiter = qScopeGuard([this] { metrics.addToGauge(u"limiter waiters"_s, -1); });
+        co_await rate_limiter.acquire();
+    }
+    limiter_span.end();
+    diagnostics->limiter_ns = timer.nsecsElapsed();
+    metrics.addEndpointTiming(endpoint, LimiterWait, ns(diagnostics->limiter_ns));
+
+    Result result;
+    if (valid && !valid() && flights_.at(key).callers == 1)
+        result = unexpected(u"Request cancelled."_s);
+    else
+    {
+        auto request_span = span("request");
+        unique_ptr<QNetworkReply> reply{instrument(network_.get(request(path, query)), endpoint)};
+        co_await qCoro(reply.get()).waitForFinished();  // TODO: QCoro>13 QCoroNetworkReply
+        request_span.end();
+
+        diagnostics->status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        diagnostics->bytes = reply->bytesAvailable();
+
+        timer.start();
+        auto parse_span = span("parse");
+        result = parseJson(reply.get());
+        parse_span.end();
+        diagnostics->parse_ns = timer.nsecsElapsed();
+        metrics.addEndpointTiming(endpoint, Parse, ns(diagnostics->parse_ns));
+    }
+
+    flights_.erase(key);
+    promise.addResult(result);
+    promise.finish();
+    co_return result;
+}
+
+QNetworkReply *API::put(const QString &path, const QUrlQuery &query, const QByteArray &body)
+{ return instrument(network_.put(request(path, query), body), u"PUT "_s + path); }
+
+QNetworkReply *API::post(const QString &path, const QUrlQuery &query, const QByteArray &body)
+{ return instrument(network_.post(request(path, query), body), u"POST "_s + path); }
+
 // -------------------------------------------------------------------------------------------------
 
-QNetworkReply *API::userProfile()
+API::Reply API::userProfile()
 {
     // https://developer.spotify.com/documentation/web-api/reference/get-current-users-profile
-    return network().get(request(u"/v1/me"_s, {}));
+    return get(u"/v1/me"_s, {});
 }
 
-// QNetworkReply *API::userTracks(uint limit, uint offset) const
-// {
-//     // https://developer.spotify.com/documentation/web-api/reference/get-users-saved-tracks
-//     return network().get(request(u"/v1/me/tracks"_s,
-//                                  {{u"limit"_s, QString::number(limit)},
-//                                   {u"offset"_s, QString::number(offset)}}));
-// }
+API::Reply API::userTracks(uint limit, uint offset, Validator valid,
+                           DiagnosticsPtr diagnostics)
+{
+    // https://developer.spotify.com/documentation/web-api/reference/get-users-saved-tracks
+    return get(u"/v1/me/tracks"_s,
+               {{u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)},
+                {u"market"_s, market_from_token}},
+               {}, ::move(valid), ::move(diagnostics));
+}
 
-QNetworkReply *API::userTopTracks(uint limit, uint offset)
+API::Reply API::userTopTracks(uint limit, uint offset, Validator valid,
+                              DiagnosticsPtr diagnostics)
 {
     // https://developer.spotify.com/documentation/web-api/reference/get-users-top-artists-and-tracks
-    return network().get(request(u"/v1/me/top/tracks"_s,
-                                 {{u"limit"_s, QString::number(limit)},
-                                  {u"offset"_s, QString::number(offset)}}));
+    return get(u"/v1/me/top/tracks"_s,
+               {{u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)}},
+               {}, ::move(valid), ::move(diagnostics));
 }
 
-QNetworkReply *API::userTopArtists(uint limit, uint offset)
+API::Reply API::userTopArtists(uint limit, uint offset, Validator valid,
+                               DiagnosticsPtr diagnostics)
 {
     // https://developer.spotify.com/documentation/web-api/reference/get-users-top-artists-and-tracks
-    return network().get(request(u"/v1/me/top/artists"_s,
-                                 {{u"limit"_s, QString::number(limit)},
-                                  {u"offset"_s, QString::number(offset)}}));
+    return get(u"/v1/me/top/artists"_s,
+               {{u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)}},
+               {}, ::move(valid), ::move(diagnostics));
 }
 
 // QNetworkReply *API::userArtists(uint limit)
 // {
 //     // https://developer.spotify.com/documentation/web-api/reference/get-followed
-//     return network().get(request(u"/v1/me/following"_s,
-//                                  {{u"limit"_s, QString::number(limit)},
-//                                   {u"type"_s, typeString(Artist)}}));
+//     return get(u"/v1/me/following"_s,
+//                {{u"limit"_s, QString::number(limit)},
+//                 {u"type"_s, typeString(Artist)}});
 // }
 
-QNetworkReply *API::userAlbums(uint limit, uint offset)
+API::Reply API::userAlbums(uint limit, uint offset, Validator valid,
+                           DiagnosticsPtr diagnostics)
 {
     // https://developer.spotify.com/documentation/web-api/reference/get-users-saved-albums
-    return network().get(request(u"/v1/me/albums"_s,
-                                 {{u"limit"_s, QString::number(limit)},
-                                  {u"offset"_s, QString::number(offset)}}));
+    return get(u"/v1/me/albums"_s,
+               {{u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)},
+                {u"market"_s, market_from_token}},
+               {}, ::move(valid), ::move(diagnostics));
 }
 
-QNetworkReply *API::userPlaylists(uint limit, uint offset)
+API::Reply API::userPlaylists(uint limit, uint offset, Validator valid,
+                              DiagnosticsPtr diagnostics)
 {
     // https://developer.spotify.com/documentation/web-api/reference/get-a-list-of-current-users-playlists
-    return network().get(request(u"/v1/me/playlists"_s,
-                                 {{u"limit"_s, QString::number(limit)},
-                                  {u"offset"_s, QString::number(offset)}}));
+    return get(u"/v1/me/playlists"_s,
+               {{u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)}},
+               {}, ::move(valid), ::move(diagnostics));
 }
 
-QNetworkReply *API::userShows(uint limit, uint offset)
+API::Reply API::playlistItems(const QString &playlist_id, uint limit, uint offset,
+                              Validator valid, DiagnosticsPtr diagnostics)
+{
+    // https://developer.spotify.com/documentation/web-api/reference/get-playlists-tracks
+    return get(u"/v1/playlists/%1/tracks"_s.arg(playlist_id),
+               {{u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)},
+                {u"market"_s, market_from_token},
+                {u"fields"_s, playlist_items_fields}},
+               u"/v1/playlists/{id}/tracks"_s, ::move(valid), ::move(diagnostics));
+}
+
+API::Reply API::userShows(uint limit, uint offset, Validator valid,
+                          DiagnosticsPtr diagnostics)
 {
     // https://developer.spotify.com/documentation/web-api/reference/get-users-saved-shows
-    return network().get(request(u"/v1/me/shows"_s,
-                                 {{u"limit"_s, QString::number(limit)},
-                                  {u"offset"_s, QString::number(offset)}}));
+    return get(u"/v1/me/shows"_s,
+               {{u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)},
+                {u"market"_s, market_from_token}},
+               {}, ::move(valid), ::move(diagnostics));
 }
 
-QNetworkReply *API::userEpisodes(uint limit, uint offset)
+API::Reply API::userEpisodes(uint limit, uint offset, Validator valid,
+                             DiagnosticsPtr diagnostics)
 {
     // https://developer.spotify.com/documentation/web-api/reference/get-users-saved-episodes
-    return network().get(request(u"/v1/me/episodes"_s,
-                                 {{u"limit"_s, QString::number(limit)},
-                                  {u"offset"_s, QString::number(offset)}}));
+    return get(u"/v1/me/episodes"_s,
+               {{u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)},
+                {u"market"_s, market_from_token}},
+               {}, ::move(valid), ::move(diagnostics));
 }
 
-QNetworkReply *API::userAudiobooks(uint limit, uint offset)
+API::Reply API::userAudiobooks(uint limit, uint offset, Validator valid,
+                               DiagnosticsPtr diagnostics)
 {
     // https://developer.spotify.com/documentation/web-api/reference/get-users-saved-audiobooks
-    return network().get(request(u"/v1/me/audiobooks"_s,
-                                 {{u"limit"_s, QString::number(limit)},
-                                  {u"offset"_s, QString::number(offset)}}));
+    return get(u"/v1/me/audiobooks"_s,
+               {{u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)}},
+               {}, ::move(valid), ::move(diagnostics));
 }
 
-QNetworkReply *API::getDevices()
+API::Reply API::getDevices()
 {
     // https://developer.spotify.com/documentation/web-api/reference/get-a-users-available-devices
-    return network().get(request(u"/v1/me/player/devices"_s,
-                                 {}));
+    return get(u"/v1/me/player/devices"_s, {});
 }
 
-QNetworkReply *API::search(const QString &query, SearchType type, uint limit, uint offset)
+API::Reply API::search(const QString &query, SearchType type, uint limit, uint offset,
+                       Validator valid, DiagnosticsPtr diagnostics)
 {
     // https://developer.spotify.com/documentation/web-api/reference/search
     // QStringList types;
@@ -245,13 +586,15 @@ QNetworkReply *API::search(const QString &query, SearchType type, uint limit, ui
     // if (types.isEmpty())
     //     types = {type_strings.begin(), type_strings.end()};
 
-    return network().get(request(u"/v1/search"_s,
-                                 {
-                                  {u"q"_s, percentEncoded(query)},
-                                  {u"type"_s, typeString(type)},
-                                  {u"limit"_s, QString::number(limit)},
-                                  {u"offset"_s, QString::number(offset)}
-                                 }));
+    return get(u"/v1/search"_s,
+               {
+                {u"q"_s, percentEncoded(query)},
+                {u"type"_s, typeString(type)},
+                {u"limit"_s, QString::number(limit)},
+                {u"offset"_s, QString::number(offset)},
+                {u"market"_s, market_from_token}
+               },
+               {}, ::move(valid), ::move(diagnostics));
 }
 
 QNetworkReply *API::play(const QStringList &uris, const QString& deviceId)
@@ -260,17 +603,14 @@ QNetworkReply *API::play(const QStringList &uris, const QString& deviceId)
     auto params = deviceId.isNull() ? QUrlQuery{} : QUrlQuery{{u"device_id"_s, deviceId}};
     auto body = QJsonObject{{u"uris"_s, QJsonArray::fromStringList(uris)}};
 
-    return network().put(request(u"/v1/me/player/play"_s, params),
-                         QJsonDocument(body).toJson());
+    return put(u"/v1/me/player/play"_s, params, QJsonDocument(body).toJson());
 }
 
 QNetworkReply *API::pause(const QString& deviceId)
 {
     // https://developer.spotify.com/documentation/web-api/reference/pause-a-users-playback
     auto params = deviceId.isNull() ? QUrlQuery{} : QUrlQuery{{u"device_id"_s, deviceId}};
-    return network().put(request(u"/v1/me/player/pause"_s,
-                                 params),
-                         QByteArray{});
+    return put(u"/v1/me/player/pause"_s, params, QByteArray{});
 }
 
 QNetworkReply *API::queue(const QString &uri, const QString& device_id)
@@ -280,7 +620,5 @@ QNetworkReply *API::queue(const QString &uri, const QString& device_id)
     if (!device_id.isNull())
         params.addQueryItem(u"device_id"_s, device_id);
 
-    return network().post(request(u"/v1/me/player/queue"_s, params),
-                          QByteArray{});
+    return post(u"/v1/me/player/queue"_s, params, QByteArray{});
 }
-
@@ -1,11 +1,27 @@
 // Copyright (c) 2025-2026 Manuel Schneider
 
 #pragma once
+#include "iconprefetcher.h"
+#include "metrics.h"
+#include "sessionrecorder.h"
+#include "tracer.h"
+#include <QCoroTask>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFuture>
 #include <QJsonDocument>
+#include <QNetworkAccessManager>
+#include <QPromise>
 #include <QString>
+#include <QTimer>
+#include <QUrl>
 #include <albert/oauth.h>
 #include <albert/ratelimiter.h>
+#include <chrono>
 #include <expected>
+#include <functional>
+#include <map>
+#include <memory>
 class QNetworkReply;
 class QNetworkRequest;
 class QUrlQuery;
@@ -28,32 +44,88 @@ class API
 {
 public:
 
+    using Reply = QCoro::Task<std::expected<QJsonDocument, QString>>;
+
+    // Checked before and after waiting for the rate limiter. The request is skipped if it returns
+    // false and no other caller waits for it.
+    using Validator = std::function<bool()>;
+
+    // Optionally passed by callers that report on their requests. Spans of the request go to the
+    // trace lane (trace_pid, trace_tid) if set, the other fields are filled in once it finished.
+    // Joined requests report the reply of the request they joined.
+    struct Diagnostics
+    {
+        qint64 trace_pid = 0;
+        qint64 trace_tid = 0;
+        int status = 0;         // HTTP status, 0 if there was no response
+        qint64 bytes = 0;       // decoded response body size
+        qint64 limiter_ns = 0;  // waiting for the rate limiter
+        qint64 parse_ns = 0;
+    };
+    using DiagnosticsPtr = std::shared_ptr<Diagnostics>;  // requests may outlive their callers
+
     API();
 
+    [[nodiscard]] const QUrl &apiUrl() const;
+    void setApiUrl(const QUrl &);
+
+    // Base URL of the OAuth authorization and token endpoints.
+    void setAccountsUrl(const QUrl &);
+
+    // Caches GET responses in the directory. Responses are not cached unless set.
+    void setCacheDirectory(const QString &path);
+
     [[nodiscard]] const QString &username() const;
 
     [[nodiscard]] bool isPremium() const;
 
-    [[nodiscard]] QNetworkReply *getDevices();
+    [[nodiscard]] const QString &product() const;
+
+    // Use cached account information until revalidated in the background.
+    void restoreAccountInformation(const QString &username, const QString &product);
+
+    // Finishes once the credentials have been loaded, successfully or not.
+    [[nodiscard]] QFuture<void> credentials() const;
+
+    void setCredentialsLoaded();
 
-    [[nodiscard]] QNetworkReply *userProfile();
+    // GET endpoints are rate limited. Identical requests in flight are sent once and their result
+    // is shared with all callers.
 
-    [[nodiscard]] QNetworkReply *search(const QString &query, SearchType types,
-                                        uint limit, uint offset);
+    [[nodiscard]] Reply getDevices();
 
-    [[nodiscard]] QNetworkReply *userTopTracks(uint limit, uint offset);
+    [[nodiscard]] Reply userProfile();
 
-    [[nodiscard]] QNetworkReply *userTopArtists(uint limit, uint offset);
+    [[nodiscard]] Reply search(const QString &query, SearchType types,
+                               uint limit, uint offset, Validator = {},
+                               DiagnosticsPtr = {});
 
-    [[nodiscard]] QNetworkReply *userAlbums(uint limit, uint offset);
+    [[nodiscard]] Reply userTracks(uint limit, uint offset, Validator = {},
+                                   DiagnosticsPtr = {});
 
-    [[nodiscard]] QNetworkReply *userPlaylists(uint limit, uint offset);
+    [[nodiscard]] Reply userTopTracks(uint limit, uint offset, Validator = {},
+                                      DiagnosticsPtr = {});
 
-    [[nodiscard]] QNetworkReply *userShows(uint limit, uint offset);
+    [[nodiscard]] Reply userTopArtists(uint limit, uint offset, Validator = {},
+                                       DiagnosticsPtr = {});
 
-    [[nodiscard]] QNetworkReply *userEpisodes(uint limit, uint offset);
+    [[nodiscard]] Reply userAlbums(uint limit, uint offset, Validator = {},
+                                   DiagnosticsPtr = {});
 
-    [[nodiscard]] QNetworkReply *userAudiobooks(uint limit, uint offset);
+    [[nodiscard]] Reply userPlaylists(uint limit, uint offset, Validator = {},
+                                      DiagnosticsPtr = {});
+
+    [[nodiscard]] Reply playlistItems(const QString &playlist_id, uint limit, uint offset,
+                                      Validator = {}, DiagnosticsPtr = {});
+
+    [[nodiscard]] Reply userShows(uint limit, uint offset, Validator = {},
+                                  DiagnosticsPtr = {});
+
+    [[nodiscard]] Reply userEpisodes(uint limit, uint offset, Validator = {},
+                                     DiagnosticsPtr = {});
+
+    [[nodiscard]] Reply userAudiobooks(uint limit, uint offset, Validator = {},
+                                       DiagnosticsPtr = {});
 
 
     [[nodiscard]] QNetworkReply *play(const QStringList &uris, const QString& deviceId = {});
@@ -62,17 +134,56 @@ public:
 
     [[nodiscard]] QNetworkReply *queue(const QString &uri, const QString& deviceId = {});
 
-    static std::expected<QJsonDocument, QString> parseJson(QNetworkReply *reply);
+    std::expected<QJsonDocument, QString> parseJson(QNetworkReply *reply);
+
+    // Marks interactive use, e.g. a query. Background work yields to it.
+    void noteInteractive();
+
+    // True if there was no interactive use for at least the given duration.
+    [[nodiscard]] bool isIdle(std::chrono::milliseconds) const;
+
+    // Expires with the API, for objects that may outlive it, e.g. items held by query results.
+    [[nodiscard]] std::weak_ptr<Metrics> weakMetrics() const;
 
     albert::OAuth2 oauth;
     albert::detail::RateLimiter rate_limiter;
+    std::function<void()> account_information_changed;
+    SessionRecorder recorder;
+    Metrics metrics;
+    Tracer tracer;
+    IconPrefetcher prefetcher;
 
 private:
 
     QNetworkRequest request(const QString &, const QUrlQuery &);
+    QNetworkReply *instrument(QNetworkReply *, const QString &endpoint);
+    Reply get(QString path, QUrlQuery, QString endpoint = {}, Validator = {}, DiagnosticsPtr = {});
+    QNetworkReply *put(const QString &path, const QUrlQuery &, const QByteArray &body);
+    QNetworkReply *post(const QString &path, const QUrlQuery &, const QByteArray &body);
     void updateAccountInformatoin();
+    void scheduleTokenRefresh();
+    void checkClock();
 
+    QNetworkAccessManager network_;  // own instance for the HTTP cache
+    QUrl api_url_;
     QString username_;
+    QString product_;
     bool is_premium_ = false;
+    bool account_information_restored_ = false;
+    QPromise<void> credentials_promise_;
+    QTimer token_refresh_timer_;
+    std::chrono::milliseconds token_refresh_retry_;  // backs off on failed refreshes
+    QTimer clock_check_timer_;
+    QDateTime last_clock_check_;
+    QElapsedTimer last_interactive_;  // invalid until the first interactive use
+    std::shared_ptr<Metrics> metrics_handle_;  // non-owning
+
+    struct Flight
+    {
+        QFuture<std::expected<QJsonDocument, QString>> result;
+        std::shared_ptr<const Diagnostics> diagnostics;
+        uint callers;
+    };
+    std::map<QString, Flight> flights_;  // by path and query
 
 };
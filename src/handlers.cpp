@@ -2,20 +2,28 @@
 
 #include "handlers.h"
 #include "items.h"
+#include "library.h"
+#include "matcher.h"
+#include "normalize.h"
 #include "plugin.h"
 #include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
 #include <QCoroAsyncGenerator>
-#include <QCoroNetworkReply>
+#include <QCoroFuture>
 #include <QCoroSignal>
 #include <QJsonArray>
 #include <QJsonObject>
-#include <QNetworkReply>
+#include <QScopeGuard>
+#include <QSet>
+#include <QStringTokenizer>
 #include <QThread>
 #include <albert/app.h>
 #include <albert/icon.h>
 #include <albert/logging.h>
 #include <albert/queryexecution.h>
 #include <albert/queryresults.h>
+#include <albert/rankitem.h>
 #include <albert/standarditem.h>
 #include <ranges>
 using namespace Qt::StringLiterals;
@@ -25,6 +33,13 @@ using namespace std;
 
 static const auto items_key = "items"_L1;
 static const auto batch_size = 10u;
+static const auto local_limit = 10u;
+static const auto local_budget = 20ms;  // time to first rows spent on the local library at most
+static const auto page_cache_size = 32u;
+static const auto prefetch_count = 5u;
+static const auto warm_up_idle_threshold = 30s;  // without interactive requests
+static const auto global_limit = 5u;
+static const auto global_budget = 5ms;
 
 static auto makeErrorItem(const QString &error)
 {
@@ -45,11 +60,14 @@ SpotifySearchHandler::SpotifySearchHandler(API &api,
                                            const QString &name,
                                            const QString &description) :
     api_(api),
+    alive_(make_shared<bool>(true)),
     type_(type),
     name_(name),
     description_(description)
 {}
 
+SpotifySearchHandler::~SpotifySearchHandler() { *alive_ = false; }
+
 QString SpotifySearchHandler::id() const { return typeString(type_); }
 
 QString SpotifySearchHandler::name() const { return name_; }
@@ -59,30 +77,244 @@ QString SpotifySearchHandler::description() const { return description_; }
 QString SpotifySearchHandler::defaultTrigger() const
 { return localizedTypeString(type_).toLower() + QChar::Space; }
 
+// Items whose search keys contain all words of the query.
+static vector<shared_ptr<Item>> filterItems(const vector<shared_ptr<Item>> &items, const QString &query)
+{
+    const auto normalized = normalizeSearchKey(query);
+    vector<QStringView> words;
+    for (const auto word : QStringTokenizer(normalized, QChar::Space, Qt::SkipEmptyParts))
+        words.emplace_back(word);
+
+    vector<shared_ptr<Item>> filtered;
+    for (const auto &item : items)
+        if (matcher::score(static_cast<const SpotifyItem &>(*item).searchKey(), words) >= 0)
+            filtered.emplace_back(item);
+    return filtered;
+}
+
+vector<shared_ptr<Item>> SpotifySearchHandler::localItems(albert::QueryContext &) { return {}; }
+
+QCoro::Task<> SpotifySearchHandler::warmUp()
+{
+    // Low priority, dropped as soon as the user interacts
+    const auto alive = alive_;
+    const auto idle = [&api = api_, alive] { return *alive && api.isIdle(warm_up_idle_threshold); };
+
+    const auto exp_items = co_await fetchPage({}, 0, idle);
+    if (!*alive)
+        co_return;
+
+    if (!exp_items)
+    {
+        if (api_.isIdle(warm_up_idle_threshold))
+            WARN << id() << "warm-up failed:" << exp_items.error();
+        else
+            DEBG << id() << "warm-up interrupted by interactive use.";
+        co_return;
+    }
+
+    // fetchPage queued the first rows already
+    vector<shared_ptr<SpotifyItem>> items;
+    for (const auto &item : *exp_items | views::drop(prefetch_count))
+        items.emplace_back(static_pointer_cast<SpotifyItem>(item));
+    api_.prefetcher.enqueue(items, idle);
+    DEBG << id() << "warmed up.";
+}
+
+QCoro::Task<expected<vector<shared_ptr<Item>>, QString>>
+SpotifySearchHandler::fetchPage(QString query, uint page, API::Validator valid,
+                                API::DiagnosticsPtr diagnostics)
+{
+    using enum Metrics::Stage;
+    using ns = chrono::nanoseconds;
+
+    // Not bound to the query session. If the session ends while the request is in flight,
+    // this completes in the background and keeps the page for the next time.
+    const auto alive = alive_;
+    if (!diagnostics)
+        diagnostics = make_shared<API::Diagnostics>();
+    const auto exp_doc = co_await fetch(query, page, valid, diagnostics);
+    if (!*alive)
+        co_return unexpected(u"Handler destroyed."_s);
+    api_.metrics.addHandlerTiming(id(), LimiterWait, ns(diagnostics->limiter_ns));
+    if (!exp_doc)
+        co_return unexpected(exp_doc.error());
+    api_.metrics.addHandlerTiming(id(), Parse, ns(diagnostics->parse_ns));
+
+    QElapsedTimer timer;
+    timer.start();
+    const auto trace_pid = static_cast<qint64>(type_) + 1;
+    auto span = api_.tracer.asyncSpan("items", trace_pid, diagnostics->trace_tid);
+    auto items = handleReply(query, *exp_doc);
+    span.end();
+
+    // Icon spans belong to the query that fetched the items
+    if (api_.tracer.isEnabled())
+        for (const auto &item : items)
+            static_pointer_cast<SpotifyItem>(item)->setTraceLane(trace_pid, diagnostics->trace_tid);
+
+    const auto items_ns = timer.nsecsElapsed();
+    api_.metrics.addHandlerTiming(id(), Items, ns(items_ns));
+    DEBG << u"%1: Decoded %2 items (parse %3 µs, items %4 µs, %5 items/s)."_s
+                .arg(id()).arg(items.size())
+                .arg(diagnostics->parse_ns / 1000).arg(items_ns / 1000)
+                .arg(items_ns ? items.size() * 1'000'000'000ll / items_ns : 0);
+
+    // Artwork of the first rows should be ready when they render
+    vector<shared_ptr<SpotifyItem>> prefetch;
+    for (const auto &item : items | views::take(prefetch_count))
+        prefetch.emplace_back(static_pointer_cast<SpotifyItem>(item));
+    api_.prefetcher.enqueue(prefetch, ::move(valid));
+
+    // Only first pages are read back, later pages depend on the session scrolling there
+    if (page == 0)
+    {
+        erase_if(page_cache_, [&](const auto &p) { return p.query == query; });
+        page_cache_.push_front({query, items});
+        if (page_cache_.size() > page_cache_size)
+            page_cache_.pop_back();
+    }
+
+    co_return items;
+}
+
 AsyncItemGenerator SpotifySearchHandler::items(albert::QueryContext &ctx)
 {
+    const auto query_id = ++query_count_;
+    api_.noteInteractive();
+    api_.recorder.record({{u"event"_s, u"query"_s},
+                          {u"handler"_s, id()},
+                          {u"qid"_s, query_id},
+                          {u"query"_s, ctx.query()}});
+
+    // Trace lanes: one process per handler, one thread per query
+    const auto trace_pid = static_cast<qint64>(type_) + 1;
+    if (api_.tracer.isEnabled())
+    {
+        api_.tracer.setProcessName(trace_pid, id());
+        api_.tracer.setLaneName(trace_pid, query_id, u"#%1 '%2'"_s.arg(query_id).arg(ctx.query()));
+    }
+
+    const auto prior_query = last_query_;
+    const auto prior_items = last_items_;
+
+    // Items yielded so far. Become the refinement base of the next query while this is the latest.
+    vector<shared_ptr<Item>> results;
+    QSet<QString> result_ids;
+    const auto add_results = [&](vector<shared_ptr<Item>> &v) {
+        erase_if(v, [&](const auto &item) { return result_ids.contains(item->id()); });
+        for (const auto &item : v)
+            result_ids.insert(item->id());
+        results.insert(results.end(), v.begin(), v.end());
+        if (query_id == query_count_)
+        {
+            last_query_ = ctx.query();
+            last_items_ = results;
+        }
+    };
+
     try {
-        for (auto page = 0;; ++page)
+        if (auto v = localItems(ctx); !v.empty())
+        {
+            add_results(v);
+            co_yield ::move(v);
+        }
+
+        // Narrowing a query: show the matching previous results until the network catches up
+        if (!prior_query.isEmpty() && ctx.query().startsWith(prior_query))
+        {
+            auto v = filterItems(prior_items, ctx.query());
+            add_results(v);
+            if (!v.empty())
+            {
+                api_.recorder.record({{u"event"_s, u"refined"_s},
+                                      {u"handler"_s, id()},
+                                      {u"qid"_s, query_id},
+                                      {u"count"_s, static_cast<qint64>(v.size())}});
+                co_yield ::move(v);
+            }
+        }
+
+        // Pages of earlier sessions are shown right away, the network refreshes them
+        if (const auto it = ranges::find_if(page_cache_, [&](const auto &p) {
+                return p.query == ctx.query();
+            });
+            it != page_cache_.end())
         {
-            co_await api_.rate_limiter.acquire();
+            auto v = it->items;
+            add_results(v);
+            if (!v.empty())
+            {
+                api_.recorder.record({{u"event"_s, u"cached"_s},
+                                      {u"handler"_s, id()},
+                                      {u"qid"_s, query_id},
+                                      {u"count"_s, static_cast<qint64>(v.size())}});
+                co_yield ::move(v);
+            }
+        }
 
+        // Secrets are loaded asynchronously on startup
+        if (!api_.credentials().isFinished())
+        {
+            co_await api_.credentials();
             if (!ctx.isValid())
                 co_return;
+        }
+
+        // Requests may outlive this generator
+        auto alive = make_shared<bool>(true);
+        const auto guard = qScopeGuard([alive] { *alive = false; });
+        const auto valid = [alive, &ctx] { return *alive && ctx.isValid(); };
+
+        for (auto page = 0u;; ++page)
+        {
+            using enum Metrics::Stage;
+            using ns = chrono::nanoseconds;
+
+            QElapsedTimer timer;
+            timer.start();
 
-            unique_ptr<QNetworkReply> reply{fetch(ctx, page)};
+            auto diagnostics = make_shared<API::Diagnostics>(
+                API::Diagnostics{.trace_pid = trace_pid, .trace_tid = query_id});
+            auto fetch_span = api_.tracer.span("fetch", trace_pid, query_id);
+            auto exp_items = co_await fetchPage(ctx.query(), page, valid, diagnostics);
+            fetch_span.end();
 
-            co_await qCoro(reply.get()).waitForFinished();  // TODO: QCoro>13 QCoroNetworkReply
+            const auto fetch_ns = timer.nsecsElapsed();
 
-            if (const auto exp_doc = API::parseJson(reply.get()); exp_doc)
+            if (!ctx.isValid())
             {
-                // TODO: GCC>13 yieling temporaries is fine
-                auto v = handleReply(ctx, *exp_doc);
+                api_.recorder.record({{u"event"_s, u"invalidated"_s},
+                                      {u"handler"_s, id()},
+                                      {u"qid"_s, query_id},
+                                      {u"page"_s, static_cast<qint64>(page)}});
+                co_return;
+            }
+
+            api_.recorder.record({{u"event"_s, u"page"_s},
+                                  {u"handler"_s, id()},
+                                  {u"qid"_s, query_id},
+                                  {u"page"_s, static_cast<qint64>(page)},
+                                  {u"ok"_s, exp_items.has_value()},
+                                  {u"bytes"_s, diagnostics->bytes},
+                                  {u"status"_s, diagnostics->status},
+                                  {u"ms"_s, fetch_ns / 1'000'000}});
+
+            if (exp_items)
+            {
+                auto &v = *exp_items;
+                add_results(v);
+                api_.metrics.addHandlerTiming(id(), Fetch, ns(fetch_ns));
+                api_.metrics.addHandlerTiming(id(), Total, ns(timer.nsecsElapsed()));
+
+                auto yield_span = api_.tracer.span("yield", trace_pid, query_id);
                 co_yield ::move(v);
+                yield_span.end();
             }
             else
             {
                 // TODO: GCC>13 yieling temporaries is fine
-                vector<shared_ptr<Item>> v{makeErrorItem(exp_doc.error())};
+                vector<shared_ptr<Item>> v{makeErrorItem(exp_items.error())};
                 co_yield ::move(v);
                 co_return;
             }
@@ -94,36 +326,106 @@ AsyncItemGenerator SpotifySearchHandler::items(albert::QueryContext &ctx)
 
 //--------------------------------------------------------------------------------------------------
 
-TrackSearchHandler::TrackSearchHandler(API &api) :
+// Reply layouts per item type. Search replies nest the items in a container object per type,
+// some library endpoints wrap each item in an object with saving metadata.
+template<class T> struct ReplyTraits;
+
+template<> struct ReplyTraits<TrackItem>
+{
+    static constexpr auto container = "tracks"_L1;
+    static constexpr QLatin1StringView wrapper{};
+};
+
+template<> struct ReplyTraits<ArtistItem>
+{
+    static constexpr auto container = "artists"_L1;
+    static constexpr QLatin1StringView wrapper{};
+};
+
+template<> struct ReplyTraits<AlbumItem>
+{
+    static constexpr auto container = "albums"_L1;
+    static constexpr auto wrapper = "album"_L1;
+};
+
+template<> struct ReplyTraits<PlaylistItem>
+{
+    static constexpr auto container = "playlists"_L1;
+    static constexpr QLatin1StringView wrapper{};
+};
+
+template<> struct ReplyTraits<ShowItem>
+{
+    static constexpr auto container = "shows"_L1;
+    static constexpr auto wrapper = "show"_L1;
+};
+
+template<> struct ReplyTraits<EpisodeItem>
+{
+    static constexpr auto container = "episodes"_L1;
+    static constexpr auto wrapper = "episode"_L1;
+};
+
+template<> struct ReplyTraits<AudiobookItem>
+{
+    static constexpr auto container = "audiobooks"_L1;
+    static constexpr QLatin1StringView wrapper{};
+};
+
+template<class T>
+static vector<shared_ptr<Item>> decode(API &api, const QJsonDocument &doc, bool library_endpoint)
+{
+    using Traits = ReplyTraits<T>;
+
+    const auto items = (library_endpoint ? doc[items_key] : doc[Traits::container][items_key]).toArray();
+
+    vector<shared_ptr<Item>> v;
+    v.reserve(items.size());
+    for (const auto &val : items)
+    {
+        QJsonValue item = val;
+        if constexpr (!Traits::wrapper.isEmpty())
+            if (library_endpoint)
+                item = val[Traits::wrapper];
+
+        // Skip null items and the null filled items of the beta episodes endpoint
+        if (const auto object = item.toObject(); object["id"_L1].isString())
+            v.emplace_back(make_shared<T>(api, object));
+    }
+    return v;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TrackSearchHandler::TrackSearchHandler(API &api, const Library &library) :
     SpotifySearchHandler(api,
                          Track,
                          Plugin::tr("Spotify tracks"),
-                         Plugin::tr("Search Spotify tracks"))
+                         Plugin::tr("Search Spotify tracks")),
+    library_(library)
 {}
 
-QNetworkReply *TrackSearchHandler::fetch(albert::QueryContext &ctx, uint page) const
+vector<shared_ptr<Item>> TrackSearchHandler::localItems(albert::QueryContext &ctx)
 {
-    return ctx.query().isEmpty()
-               ? api_.userTopTracks(batch_size, page * batch_size)
-               : api_.search(ctx, Track, batch_size, page * batch_size);
+    vector<shared_ptr<Item>> items;
+    if (!ctx.query().isEmpty())
+        for (auto &[r, score] : library_.match(ctx.query(), local_limit, QDeadlineTimer(local_budget)))
+            items.emplace_back(make_shared<TrackItem>(api_, r.id, r.name, r.description, r.image_url, r.key));
+    return items;
 }
 
-vector<shared_ptr<Item>>
-TrackSearchHandler::handleReply(albert::QueryContext &ctx, const QJsonDocument &doc)
+API::Reply TrackSearchHandler::fetch(const QString &query, uint page, API::Validator valid,
+                                     API::DiagnosticsPtr diagnostics) const
 {
-    const auto items = ctx.query().isEmpty()
-                           ? doc[items_key]
-                           : doc[u"%1s"_s.arg(typeString(type_))][items_key];
-
-    auto v = items.toArray()
-           | views::filter([](const auto &val) { return !val.isNull(); })
-           | views::transform([this](const auto &val) {
-                 return make_shared<TrackItem>(api_, val.toObject());
-             });
-
-    return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
+    return query.isEmpty()
+               ? api_.userTopTracks(batch_size, page * batch_size, ::move(valid), ::move(diagnostics))
+               : api_.search(query, Track, batch_size, page * batch_size, ::move(valid), ::move(diagnostics));
 }
 
+vector<shared_ptr<Item>>
+TrackSearchHandler::handleReply(const QString &query, const QJsonDocument &doc)
+{ return decode<TrackItem>(api_, doc, query.isEmpty()); }
+
 //--------------------------------------------------------------------------------------------------
 
 ArtistSearchHandler::ArtistSearchHandler(API &api) :
@@ -133,27 +435,17 @@ ArtistSearchHandler::ArtistSearchHandler(API &api) :
                          Plugin::tr("Search Spotify artists"))
 {}
 
-QNetworkReply *ArtistSearchHandler::fetch(albert::QueryContext &ctx, uint page) const
+API::Reply ArtistSearchHandler::fetch(const QString &query, uint page, API::Validator valid,
+                                      API::DiagnosticsPtr diagnostics) const
 {
-    return ctx.query().isEmpty()
-               ? api_.userTopArtists(batch_size, page * batch_size)
-               : api_.search(ctx, type_, batch_size, page * batch_size);
+    return query.isEmpty()
+               ? api_.userTopArtists(batch_size, page * batch_size, ::move(valid), ::move(diagnostics))
+               : api_.search(query, type_, batch_size, page * batch_size, ::move(valid), ::move(diagnostics));
 }
 
 vector<shared_ptr<Item>>
-ArtistSearchHandler::handleReply(albert::QueryContext &ctx, const QJsonDocument &doc)
-{
-    const auto items = ctx.query().isEmpty() ? doc[items_key]
-                                             : doc[u"%1s"_s.arg(typeString(type_))][items_key];
-
-    auto v = items.toArray()
-             | views::filter([](const auto &val) { return !val.isNull(); })
-             | views::transform([this](const auto &val) {
-                     return make_shared<ArtistItem>(api_, val.toObject());
-               });
-
-    return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
-}
+ArtistSearchHandler::handleReply(const QString &query, const QJsonDocument &doc)
+{ return decode<ArtistItem>(api_, doc, query.isEmpty()); }
 
 //--------------------------------------------------------------------------------------------------
 
@@ -164,36 +456,17 @@ AlbumSearchHandler::AlbumSearchHandler(API &api) :
                          Plugin::tr("Search Spotify albums"))
 {}
 
-QNetworkReply *AlbumSearchHandler::fetch(albert::QueryContext &ctx, uint page) const
+API::Reply AlbumSearchHandler::fetch(const QString &query, uint page, API::Validator valid,
+                                     API::DiagnosticsPtr diagnostics) const
 {
-    return ctx.query().isEmpty()
-               ? api_.userAlbums(batch_size, page * batch_size)
-               : api_.search(ctx, type_, batch_size, page * batch_size);
+    return query.isEmpty()
+               ? api_.userAlbums(batch_size, page * batch_size, ::move(valid), ::move(diagnostics))
+               : api_.search(query, type_, batch_size, page * batch_size, ::move(valid), ::move(diagnostics));
 }
 
 vector<shared_ptr<Item>>
-AlbumSearchHandler::handleReply(albert::QueryContext &ctx, const QJsonDocument &doc)
-{
-    if (ctx.query().isEmpty())
-    {
-        auto v = doc[items_key].toArray()
-                 | views::filter([](const auto &val) { return !val.isNull(); })
-                 | views::transform([this](const auto &val) {
-                       const auto album = val[typeString(type_)].toObject();
-                       return make_shared<AlbumItem>(api_, album);
-                   });
-        return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
-    }
-    else
-    {
-        auto v = doc[u"%1s"_s.arg(typeString(type_))][items_key].toArray()
-                 | views::filter([](const auto &val) { return !val.isNull(); })
-                 | views::transform([this](const auto &val) {
-                       return make_shared<AlbumItem>(api_, val.toObject());
-                   });
-        return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
-    }
-}
+AlbumSearchHandler::handleReply(const QString &query, const QJsonDocument &doc)
+{ return decode<AlbumItem>(api_, doc, query.isEmpty()); }
 
 //--------------------------------------------------------------------------------------------------
 
@@ -204,28 +477,17 @@ PlaylistSearchHandler::PlaylistSearchHandler(API &api) :
                          Plugin::tr("Search Spotify playlists"))
 {}
 
-QNetworkReply *PlaylistSearchHandler::fetch(albert::QueryContext &ctx, uint page) const
+API::Reply PlaylistSearchHandler::fetch(const QString &query, uint page, API::Validator valid,
+                                        API::DiagnosticsPtr diagnostics) const
 {
-    return ctx.query().isEmpty()
-               ? api_.userPlaylists(batch_size, page * batch_size)
-               : api_.search(ctx, type_, batch_size, page * batch_size);
+    return query.isEmpty()
+               ? api_.userPlaylists(batch_size, page * batch_size, ::move(valid), ::move(diagnostics))
+               : api_.search(query, type_, batch_size, page * batch_size, ::move(valid), ::move(diagnostics));
 }
 
 vector<shared_ptr<Item>>
-PlaylistSearchHandler::handleReply(albert::QueryContext &ctx, const QJsonDocument &doc)
-{
-    const auto items = ctx.query().isEmpty()
-                           ? doc[items_key]
-                           : doc[u"%1s"_s.arg(typeString(type_))][items_key];
-
-    auto v = items.toArray()
-             | views::filter([](const auto &val) { return !val.isNull(); })
-             | views::transform([this](const auto &val) {
-                   return make_shared<PlaylistItem>(api_, val.toObject());
-               });
-
-    return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
-}
+PlaylistSearchHandler::handleReply(const QString &query, const QJsonDocument &doc)
+{ return decode<PlaylistItem>(api_, doc, query.isEmpty()); }
 
 //--------------------------------------------------------------------------------------------------
 
@@ -236,36 +498,17 @@ ShowSearchHandler::ShowSearchHandler(API &api) :
                          Plugin::tr("Search Spotify shows"))
 {}
 
-QNetworkReply *ShowSearchHandler::fetch(albert::QueryContext &ctx, uint page) const
+API::Reply ShowSearchHandler::fetch(const QString &query, uint page, API::Validator valid,
+                                    API::DiagnosticsPtr diagnostics) const
 {
-    return ctx.query().isEmpty()
-               ? api_.userShows(batch_size, page * batch_size)
-               : api_.search(ctx, type_, batch_size, page * batch_size);
+    return query.isEmpty()
+               ? api_.userShows(batch_size, page * batch_size, ::move(valid), ::move(diagnostics))
+               : api_.search(query, type_, batch_size, page * batch_size, ::move(valid), ::move(diagnostics));
 }
 
 vector<shared_ptr<Item>>
-ShowSearchHandler::handleReply(albert::QueryContext &ctx, const QJsonDocument &doc)
-{
-    if (ctx.query().isEmpty())
-    {
-        auto v = doc[items_key].toArray()
-                 | views::filter([](const auto &val) { return !val.isNull(); })
-                 | views::transform([this](const auto &val) {
-                       const auto album = val[typeString(type_)].toObject();
-                       return make_shared<ShowItem>(api_, album);
-                   });
-        return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
-    }
-    else
-    {
-        auto v = doc[u"%1s"_s.arg(typeString(type_))][items_key].toArray()
-                 | views::filter([](const auto &val) { return !val.isNull(); })
-                 | views::transform([this](const auto &val) {
-                       return make_shared<ShowItem>(api_, val.toObject());
-                   });
-        return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
-    }
-}
+ShowSearchHandler::handleReply(const QString &query, const QJsonDocument &doc)
+{ return decode<ShowItem>(api_, doc, query.isEmpty()); }
 
 //--------------------------------------------------------------------------------------------------
 
@@ -276,38 +519,17 @@ EpisodeSearchHandler::EpisodeSearchHandler(API &api) :
                          Plugin::tr("Search Spotify episodes"))
 {}
 
-QNetworkReply *EpisodeSearchHandler::fetch(albert::QueryContext &ctx, uint page) const
+API::Reply EpisodeSearchHandler::fetch(const QString &query, uint page, API::Validator valid,
+                                       API::DiagnosticsPtr diagnostics) const
 {
-    return ctx.query().isEmpty()
-               ? api_.userEpisodes(batch_size, page * batch_size)
-               : api_.search(ctx, type_, batch_size, page * batch_size);
+    return query.isEmpty()
+               ? api_.userEpisodes(batch_size, page * batch_size, ::move(valid), ::move(diagnostics))
+               : api_.search(query, type_, batch_size, page * batch_size, ::move(valid), ::move(diagnostics));
 }
 
 vector<shared_ptr<Item>>
-EpisodeSearchHandler::handleReply(albert::QueryContext &ctx, const QJsonDocument &doc)
-{
-    if (ctx.query().isEmpty())
-    {
-       // endpoint beta and buggy af random null and non null but null filled items
-       auto v = doc[items_key].toArray()
-                | views::filter([](const auto &val) { return !val.isNull(); })
-                | views::transform([this](const auto &val) { return val[typeString(type_)]; })
-                | views::filter([](const auto &val) { return !val["id"_L1].isNull(); })
-                | views::transform([this](const auto &val) {
-                      return make_shared<EpisodeItem>(api_, val.toObject());
-                  });
-       return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
-    }
-    else
-    {
-        auto v = doc[u"%1s"_s.arg(typeString(type_))][items_key].toArray()
-                 | views::filter([](const auto &val) { return !val.isNull(); })
-                 | views::transform([this](const auto &val) {
-                       return make_shared<EpisodeItem>(api_, val.toObject());
-                   });
-        return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
-    }
-}
+EpisodeSearchHandler::handleReply(const QString &query, const QJsonDocument &doc)
+{ return decode<EpisodeItem>(api_, doc, query.isEmpty()); }
 
 //--------------------------------------------------------------------------------------------------
 
@@ -318,25 +540,51 @@ AudiobookSearchHandler::AudiobookSearchHandler(API &api) :
                          Plugin::tr("Search Spotify audiobooks"))
 {}
 
-QNetworkReply *AudiobookSearchHandler::fetch(albert::QueryContext &ctx, uint page) const
+API::Reply AudiobookSearchHandler::fetch(const QString &query, uint page, API::Validator valid,
+                                         API::DiagnosticsPtr diagnostics) const
 {
-    return ctx.query().isEmpty()
-               ? api_.userAudiobooks(batch_size, page * batch_size)
-               : api_.search(ctx, type_, batch_size, page * batch_size);
+    return query.isEmpty()
+               ? api_.userAudiobooks(batch_size, page * batch_size, ::move(valid), ::move(diagnostics))
+               : api_.search(query, type_, batch_size, page * batch_size, ::move(valid), ::move(diagnostics));
 }
 
 vector<shared_ptr<Item>>
-AudiobookSearchHandler::handleReply(albert::QueryContext &ctx, const QJsonDocument &doc)
+AudiobookSearchHandler::handleReply(const QString &query, const QJsonDocument &doc)
+{ return decode<AudiobookItem>(api_, doc, query.isEmpty()); }
+
+//--------------------------------------------------------------------------------------------------
+
+LibraryQueryHandler::LibraryQueryHandler(API &api, const Library &library) :
+    api_(api),
+    library_(library)
+{}
+
+QString LibraryQueryHandler::id() const { return u"library"_s; }
+
+QString LibraryQueryHandler::name() const { return Plugin::tr("Spotify library"); }
+
+QString LibraryQueryHandler::description() const
+{ return Plugin::tr("Search the synced Spotify library"); }
+
+vector<RankItem> LibraryQueryHandler::rankItems(QueryContext &ctx)
 {
-    const auto items = ctx.query().isEmpty()
-                           ? doc[items_key]
-                           : doc[u"%1s"_s.arg(typeString(type_))][items_key];
+    vector<RankItem> items;
+    if (ctx.query().isEmpty())
+        return items;
 
-    auto v = items.toArray()
-             | views::filter([](const auto &val) { return !val.isNull(); })
-             | views::transform([this](const auto &val) {
-                   return make_shared<AudiobookItem>(api_, val.toObject());
-               });
+    QElapsedTimer timer;
+    timer.start();
+
+    const auto query_size = normalizeSearchKey(ctx.query()).size();
+    for (auto &[r, score] : library_.match(ctx.query(), global_limit, QDeadlineTimer(global_budget)))
+    {
+        // Items are QObjects, global queries run in worker threads
+        auto item = make_shared<TrackItem>(api_, r.id, r.name, r.description, r.image_url, r.key);
+        item->moveToThread(qApp->thread());
+        items.emplace_back(::move(item),
+                           min(1.0, static_cast<double>(query_size) / static_cast<double>(r.key.size())));
+    }
 
-    return vector<shared_ptr<Item>>{begin(v), end(v)};  // ranges::to
+    api_.metrics.addHandlerTiming(id(), Metrics::Stage::Total, chrono::nanoseconds(timer.nsecsElapsed()));
+    return items;
 }
@@ -3,7 +3,10 @@
 #pragma once
 #include "api.h"
 #include <albert/asyncgeneratorqueryhandler.h>
+#include <albert/globalqueryhandler.h>
 #include <albert/networkutil.h>
+#include <deque>
+class Library;
 class Plugin;
 class QJsonArray;
 class SpotifyItem;
@@ -15,6 +18,7 @@ public:
                          SearchType type,
                          const QString &name,
                          const QString &description);
+    ~SpotifySearchHandler() override;
 
     QString id() const override;
     QString name() const override;
@@ -22,76 +26,126 @@ public:
     QString defaultTrigger() const override;
     albert::AsyncItemGenerator items(albert::QueryContext &) override;
 
-    virtual QNetworkReply *fetch(albert::QueryContext &ctx, uint page) const = 0;
+    // Fetches the first page of the empty query into the page cache, including its artwork.
+    // Dropped on interactive use.
+    QCoro::Task<> warmUp();
+
+    // Results available without network, yielded first.
+    virtual std::vector<std::shared_ptr<albert::Item>> localItems(albert::QueryContext &ctx);
+
+    virtual API::Reply fetch(const QString &query, uint page, API::Validator,
+                             API::DiagnosticsPtr) const = 0;
     virtual std::vector<std::shared_ptr<albert::Item>>
-    handleReply(albert::QueryContext &ctx, const QJsonDocument &doc) = 0;
+    handleReply(const QString &query, const QJsonDocument &doc) = 0;
+
+    // Fetches and decodes a page, first pages are kept in the page cache. The page path of items().
+    QCoro::Task<std::expected<std::vector<std::shared_ptr<albert::Item>>, QString>>
+    fetchPage(QString query, uint page, API::Validator, API::DiagnosticsPtr = {});
 
 protected:
+
     API &api_;
+    std::shared_ptr<bool> alive_;  // requests may outlive the handler
     const SearchType type_;
     const QString name_;
     const QString description_;
+    qint64 query_count_ = 0;
+
+    // Results of the latest query, refined locally while an extending query is fetched.
+    QString last_query_;
+    std::vector<std::shared_ptr<albert::Item>> last_items_;
+
+    struct CachedPage
+    {
+        QString query;
+        std::vector<std::shared_ptr<albert::Item>> items;
+    };
+    std::deque<CachedPage> page_cache_;  // first pages, most recent first
 };
 
 class TrackSearchHandler : public SpotifySearchHandler
 {
 public:
-    TrackSearchHandler(API&);
-    QNetworkReply *fetch(albert::QueryContext &ctx, uint page) const override;
+    TrackSearchHandler(API&, const Library&);
+    std::vector<std::shared_ptr<albert::Item>> localItems(albert::QueryContext &ctx) override;
+    API::Reply fetch(const QString &query, uint page, API::Validator,
+                     API::DiagnosticsPtr) const override;
     std::vector<std::shared_ptr<albert::Item>>
-    handleReply(albert::QueryContext &ctx, const QJsonDocument &doc) override;
+    handleReply(const QString &query, const QJsonDocument &doc) override;
+private:
+    const Library &library_;
 };
 
 class ArtistSearchHandler : public SpotifySearchHandler
 {
 public:
     ArtistSearchHandler(API&);
-    QNetworkReply *fetch(albert::QueryContext &ctx, uint page) const override;
+    API::Reply fetch(const QString &query, uint page, API::Validator,
+                     API::DiagnosticsPtr) const override;
     std::vector<std::shared_ptr<albert::Item>>
-    handleReply(albert::QueryContext &ctx, const QJsonDocument &doc) override;
+    handleReply(const QString &query, const QJsonDocument &doc) override;
 };
 
 class AlbumSearchHandler : public SpotifySearchHandler
 {
 public:
     AlbumSearchHandler(API&);
-    QNetworkReply *fetch(albert::QueryContext &ctx, uint page) const override;
+    API::Reply fetch(const QString &query, uint page, API::Validator,
+                     API::DiagnosticsPtr) const override;
     std::vector<std::shared_ptr<albert::Item>>
-    handleReply(albert::QueryContext &ctx, const QJsonDocument &doc) override;
+    handleReply(const QString &query, const QJsonDocument &doc) override;
 };
 
 class  PlaylistSearchHandler : public SpotifySearchHandler
 {
 public:
     PlaylistSearchHandler(API&);
-    QNetworkReply *fetch(albert::QueryContext &ctx, uint page) const override;
+    API::Reply fetch(const QString &query, uint page, API::Validator,
+                     API::DiagnosticsPtr) const override;
     std::vector<std::shared_ptr<albert::Item>>
-    handleReply(albert::QueryContext &ctx, const QJsonDocument &doc) override;
+    handleReply(const QString &query, const QJsonDocument &doc) override;
 };
 
 class ShowSearchHandler : public SpotifySearchHandler
 {
 public:
     ShowSearchHandler(API&);
-    QNetworkReply *fetch(albert::QueryContext &ctx, uint page) const override;
+    API::Reply fetch(const QString &query, uint page, API::Validator,
+                     API::DiagnosticsPtr) const override;
     std::vector<std::shared_ptr<albert::Item>>
-    handleReply(albert::QueryContext &ctx, const QJsonDocument &doc) override;
+    handleReply(const QString &query, const QJsonDocument &doc) override;
 };
 
 class EpisodeSearchHandler : public SpotifySearchHandler
 {
 public:
     EpisodeSearchHandler(API&);
-    QNetworkReply *fetch(albert::QueryContext &ctx, uint page) const override;
+    API::Reply fetch(const QString &query, uint page, API::Validator,
+                     API::DiagnosticsPtr) const override;
     std::vector<std::shared_ptr<albert::Item>>
-    handleReply(albert::QueryContext &ctx, const QJsonDocument &doc) override;
+    handleReply(const QString &query, const QJsonDocument &doc) override;
 };
 
 class AudiobookSearchHandler : public SpotifySearchHandler
 {
 public:
     AudiobookSearchHandler(API&);
-    QNetworkReply *fetch(albert::QueryContext &ctx, uint page) const override;
+    API::Reply fetch(const QString &query, uint page, API::Validator,
+                     API::DiagnosticsPtr) const override;
     std::vector<std::shared_ptr<albert::Item>>
-    handleReply(albert::QueryContext &ctx, const QJsonDocument &doc) override;
+    handleReply(const QString &query, const QJsonDocument &doc) override;
+};
+
+// Serves global queries from the local library within a time budget. Never touches the network.
+class LibraryQueryHandler : public albert::GlobalQueryHandler
+{
+public:
+    LibraryQueryHandler(API&, const Library&);
+    QString id() const override;
+    QString name() const override;
+    QString description() const override;
+    std::vector<albert::RankItem> rankItems(albert::QueryContext &) override;
+private:
+    API &api_;
+    const Library &library_;
 };
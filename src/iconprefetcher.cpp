@@ -0,0 +1,74 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "iconprefetcher.h"
+#include "items.h"
+#include <albert/download.h>
+using namespace albert;
+using namespace std;
+
+static const size_t max_downloads = 4;
+static const auto download_timeout = 30s;
+
+IconPrefetcher::IconPrefetcher()
+{
+    stall_timer_.setSingleShot(true);
+    stall_timer_.setInterval(download_timeout);
+    connect(&stall_timer_, &QTimer::timeout, this, &IconPrefetcher::pump);
+}
+
+bool IconPrefetcher::isEnabled() const { return enabled_; }
+
+void IconPrefetcher::setEnabled(bool enabled)
+{
+    if (!(enabled_ = enabled))
+        queue_.clear();
+}
+
+void IconPrefetcher::enqueue(const vector<shared_ptr<SpotifyItem>> &items, function<bool()> valid)
+{
+    if (!enabled_)
+        return;
+
+    for (const auto &item : items)
+        queue_.push_back({item, valid});
+    pump();
+}
+
+void IconPrefetcher::pump()
+{
+    // Free the slots of finished, dropped and stalled downloads
+    erase_if(downloads_, [](const auto &s) { return s.download.expired() || s.deadline.hasExpired(); });
+
+    while (downloads_.size() < max_downloads && !queue_.empty())
+    {
+        auto [weak_item, valid] = ::move(queue_.front());
+        queue_.pop_front();
+
+        const auto item = weak_item.lock();
+        if (!item || !valid())
+            continue;  // cancelled
+        if (item->download_pending_)
+            continue;  // queued twice or loading for display, owns a slot or needs none
+
+        item->loadIcon();
+
+        if (item->download_pending_)
+        {
+            // The item keeps the download alive, the slot must not
+            const auto &download = item->download_;
+            downloads_.push_back({download.get(), download, QDeadlineTimer(download_timeout)});
+
+            connect(download.get(), &Download::finished, this, [this, id = download.get()] {
+                erase_if(downloads_, [id](const auto &s) { return s.id == id; });
+                pump();
+            }, Qt::SingleShotConnection);
+
+            // The item may drop the download before it finishes
+            connect(download.get(), &QObject::destroyed, this, &IconPrefetcher::pump,
+                    Qt::QueuedConnection);
+        }
+    }
+
+    if (!queue_.empty() && !stall_timer_.isActive())
+        stall_timer_.start();
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QDeadlineTimer>
+#include <QObject>
+#include <QTimer>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+class SpotifyItem;
+namespace albert { class Download; }
+
+// Loads the icons of items ahead of display, in order. Downloads are capped, queued items are
+// skipped once their validator returns false or the item is gone.
+//
+// Holds neither items nor downloads. Pending callbacks die with this object.
+class IconPrefetcher : public QObject
+{
+public:
+
+    IconPrefetcher();
+
+    [[nodiscard]] bool isEnabled() const;
+    void setEnabled(bool);
+
+    void enqueue(const std::vector<std::shared_ptr<SpotifyItem>> &items, std::function<bool()> valid);
+
+private:
+
+    void pump();
+
+    struct Prefetch
+    {
+        std::weak_ptr<SpotifyItem> item;
+        std::function<bool()> valid;
+    };
+
+    struct Slot
+    {
+        const albert::Download *id;
+        std::weak_ptr<albert::Download> download;
+        QDeadlineTimer deadline;  // stalled downloads free their slot eventually
+    };
+
+    bool enabled_ = true;
+    std::deque<Prefetch> queue_;
+    std::vector<Slot> downloads_;
+    QTimer stall_timer_;
+
+};
@@ -2,7 +2,10 @@
 
 #include "api.h"
 #include "items.h"
+#include "normalize.h"
+#include <QCryptographicHash>
 #include <QDir>
+#include <QImageReader>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QNetworkReply>
@@ -17,6 +20,8 @@ using namespace Qt::StringLiterals;
 using namespace albert;
 using namespace std;
 
+static const qint64 icon_cache_size = 100 * 1024 * 1024;
+
 #if defined Q_OS_MAC
 static void pauseSpotify()
 {
@@ -44,55 +49,158 @@ SpotifyItem::SpotifyItem(API &api,
                          const QString &spotify_id,
                          const QString &title,
                          const QString &description,
-                         const QString &icon_url) :
+                         const QString &icon_url,
+                         const QString &search_key) :
     api_(api),
+    metrics_(api.weakMetrics()),
     spotify_id_(spotify_id),
     title_(title),
     description_(description),
-    icon_url_(icon_url)
+    icon_url_(icon_url),
+    search_key_(search_key.isNull() ? normalizeSearchKey(title + QChar::Space + description) : search_key)
+{
+    bytes_ = static_cast<qint64>(sizeof(SpotifyItem))
+             + (spotify_id_.capacity() + title_.capacity() + description_.capacity()
+                + icon_url_.capacity() + search_key_.capacity()) * static_cast<qint64>(sizeof(QChar));
+    addToGauge(u"items"_s, 1);
+    addToGauge(u"item bytes"_s, bytes_);
+}
+
+SpotifyItem::~SpotifyItem()
+{
+    addToGauge(u"items"_s, -1);
+    addToGauge(u"item bytes"_s, -bytes_);
+    if (icon_)
+    {
+        addToGauge(u"icons"_s, -1);
+        addToGauge(u"icon bytes"_s, -icon_bytes_);
+    }
+    if (download_pending_)
+        addToGauge(u"icon downloads"_s, -1);
+}
+
+void SpotifyItem::addToGauge(const QString &name, qint64 delta) const
 {
+    if (const auto metrics = metrics_.lock())
+        metrics->addToGauge(name, delta);
 }
 
-SpotifyItem::~SpotifyItem() = default;
+// Decoded size, reads the image header only
+static qint64 decodedImageBytes(const QString &path)
+{
+    const auto size = QImageReader(path).size();
+    return size.isValid() ? static_cast<qint64>(size.width()) * size.height() * 4 : 0;
+}
+
+void SpotifyItem::setIcon(unique_ptr<Icon> icon, qint64 bytes) const
+{
+    if (icon_)
+    {
+        addToGauge(u"icons"_s, -1);
+        addToGauge(u"icon bytes"_s, -icon_bytes_);
+    }
+
+    icon_ = ::move(icon);
+    icon_bytes_ = bytes;
+
+    if (icon_)
+    {
+        addToGauge(u"icons"_s, 1);
+        addToGauge(u"icon bytes"_s, icon_bytes_);
+    }
+}
 
 QString SpotifyItem::id() const { return spotify_id_; }
 
+void SpotifyItem::setTraceLane(qint64 pid, qint64 tid)
+{
+    trace_pid_ = pid;
+    trace_tid_ = tid;
+}
+
+QString SpotifyItem::iconsLocation() { return QDir(app().cacheLocation() / "spotify" / "icons").path(); }
+
+void SpotifyItem::pruneIcons()
+{
+    QDir dir(iconsLocation());
+    auto files = dir.entryInfoList(QDir::Files, QDir::Time);  // newest first
+
+    qint64 size = 0;
+    uint removed = 0;
+    for (const auto &file : files)
+        if (size += file.size(); size > icon_cache_size && QFile::remove(file.filePath()))
+            ++removed;
+
+    if (removed)
+        DEBG << "Pruned" << removed << "cached icons.";
+}
+
 QString SpotifyItem::text() const { return title_; }
 
 QString SpotifyItem::subtext() const { return description_; }
 
+const QString &SpotifyItem::searchKey() const { return search_key_; }
+
 std::unique_ptr<Icon> SpotifyItem::icon() const
 {
-    if (!icon_)  // lazy, first request
-    {
-        const auto icons_location = app().cacheLocation() / "spotify" / "icons";
+    loadIcon();
+    return icon_ ? icon_->clone() : nullptr;  // awaiting if null
+}
 
-        if (const auto icon_path = QDir(icons_location).filePath(id() + u".jpeg"_s);
-            QFile::exists(icon_path))
-            icon_ = Icon::iconified(Icon::image(icon_path), Icon::iconifiedDefaultBackgroundBrush(), .4);
+void SpotifyItem::loadIcon() const
+{
+    if (!icon_ && icon_url_.isEmpty())  // no artwork, the hash would be shared
+        setIcon(Icon::theme(u"spotify"_s), 0);
+    else if (!icon_)  // lazy, first request
+    {
+        // Artwork urls are content addressed, keying by url picks up changed artwork
+        const auto icon_name = QString::fromLatin1(
+            QCryptographicHash::hash(icon_url_.toUtf8(), QCryptographicHash::Md5).toHex());
+        const auto icon_path = QDir(iconsLocation()).filePath(icon_name + u".jpeg"_s);
+        const auto cached = QFile::exists(icon_path);
+        if (!download_)
+            if (const auto metrics = metrics_.lock())
+                metrics->addCacheLookup(u"icons"_s, cached);
+
+        if (cached)
+        {
+            auto span = api_.tracer.asyncSpan("icon decode", trace_pid_, trace_tid_);
+            setIcon(Icon::iconified(Icon::image(icon_path), Icon::iconifiedDefaultBackgroundBrush(), .4),
+                    decodedImageBytes(icon_path));
+        }
 
         else if (!download_)
         {
             download_ = Download::unique(icon_url_, icon_path);
+            download_pending_ = true;
+            addToGauge(u"icon downloads"_s, 1);
+
+            auto span = make_shared<Tracer::Span>(api_.tracer.asyncSpan("icon download", trace_pid_, trace_tid_));
 
             connect(download_.get(), &Download::finished, this, [=, this]{
+                span->end();
+                download_pending_ = false;
+                addToGauge(u"icon downloads"_s, -1);
+
                 if (const auto error = download_->error();
                     error.isNull())
-                    icon_ = Icon::iconified(Icon::image(download_->path()),
+                {
+                    auto decode_span = api_.tracer.asyncSpan("icon decode", trace_pid_, trace_tid_);
+                    setIcon(Icon::iconified(Icon::image(download_->path()),
                                             Icon::iconifiedDefaultBackgroundBrush(),
-                                            .4);
+                                            .4),
+                            decodedImageBytes(download_->path()));
+                }
                 else
                 {
                     WARN << "Failed to download icon:" << error;
-                    icon_ = Icon::theme(u"spotify"_s);
+                    setIcon(Icon::theme(u"spotify"_s), 0);
                 }
 
                 dataChanged();
             });
         }
     }
-
-    return icon_ ? icon_->clone() : nullptr;  // awaiting if null
 }
 
 QString SpotifyItem::uri() const { return u"spotify:%1:%2"_s.arg(typeString(type()), id()); }
@@ -110,8 +218,8 @@ QString SpotifyItem::tr_queue()  { return tr("Add to queue"); }
 static void play(API &api, const QString &uri)
 {
     const auto reply = api.play({uri});
-    QObject::connect(reply, &QNetworkReply::finished, reply, [reply, uri]{
-        if (const auto exp_doc = API::parseJson(reply);
+    QObject::connect(reply, &QNetworkReply::finished, reply, [&api, reply, uri]{
+        if (const auto exp_doc = api.parseJson(reply);
             !exp_doc)
         {
             DEBG << "Failed to play" << uri << exp_doc.error();
@@ -126,15 +234,15 @@ static void play(API &api, const QString &uri)
 static void queue(API &api, const QString &uri)
 {
     const auto reply = api.queue({uri});
-    QObject::connect(reply, &QNetworkReply::finished, reply, [reply, uri]{
-        if (const auto exp_doc = API::parseJson(reply); !exp_doc)
+    QObject::connect(reply, &QNetworkReply::finished, reply, [&api, reply, uri]{
+        if (const auto exp_doc = api.parseJson(reply); !exp_doc)
             WARN << "Failed to queue" << uri << exp_doc.error();
         else
             DEBG << "Successfully queued" << uri;
     });
 }
 
-static QString pickImageUrl(const QJsonArray &arr)
+QString pickImageUrl(const QJsonArray &arr)
 {
     if (arr.isEmpty())
         return {};
@@ -165,7 +273,7 @@ static QString pickImageUrl(const QJsonArray &arr)
 
 // -------------------------------------------------------------------------------------------------
 
-static QString makeTrackDescription(const QJsonObject &json)
+QString makeTrackDescription(const QJsonObject &json)
 {
     auto view = json["artists"_L1].toArray()
                 | views::transform([](const QJsonValue &a) { return a["name"_L1].toString(); });
@@ -181,6 +289,15 @@ TrackItem::TrackItem(API &api, const QJsonObject &json) :
                 pickImageUrl(json["album"_L1]["images"_L1].toArray()))
 {}
 
+TrackItem::TrackItem(API &api,
+                     const QString &spotify_id,
+                     const QString &title,
+                     const QString &description,
+                     const QString &icon_url,
+                     const QString &search_key) :
+    SpotifyItem(api, spotify_id, title, description, icon_url, search_key)
+{}
+
 SearchType TrackItem::type() const { return Track; }
 
 vector<Action> TrackItem::actions() const
@@ -203,7 +320,7 @@ vector<Action> TrackItem::actions() const
 
 // -------------------------------------------------------------------------------------------------
 
-static QString makeArtistDescription(const QJsonObject &json)
+QString makeArtistDescription(const QJsonObject &json)
 {
     const auto view = json["genres"_L1].toArray()
                       | views::transform([](const QJsonValue &a) {
@@ -5,6 +5,7 @@
 #include <QObject>
 #include <albert/item.h>
 #include <memory>
+class QJsonArray;
 class QJsonObject;
 namespace albert { class Download; class Icon; }
 
@@ -12,11 +13,13 @@ class SpotifyItem : public QObject, public albert::detail::DynamicItem
 {
     Q_OBJECT
 public:
+    // Computes the search key unless given.
     SpotifyItem(API &api,
                 const QString &spotify_id,
                 const QString &title,
                 const QString &description,
-                const QString &icon_url);
+                const QString &icon_url,
+                const QString &search_key = {});
     ~SpotifyItem();
 
     QString id() const override;
@@ -27,6 +30,18 @@ public:
     virtual SearchType type() const = 0;
     QString uri() const;
 
+    // Normalized text and subtext.
+    const QString &searchKey() const;
+
+    static QString iconsLocation();
+
+    // Tags the icon download and decode spans, e.g. with the handler and query.
+    void setTraceLane(qint64 pid, qint64 tid);
+
+    // Removes the least recently downloaded icons exceeding the cache size limit.
+    // Call in the main thread, icons are downloaded and loaded there.
+    static void pruneIcons();
+
 protected:
 
     static QString tr_show_in();
@@ -35,20 +50,50 @@ protected:
     static QString tr_queue();
 
     API &api_;
+    std::weak_ptr<Metrics> metrics_;  // items may outlive the API
     QString spotify_id_;
     QString title_;
     QString description_;
     QString icon_url_;
+    QString search_key_;
     mutable std::unique_ptr<albert::Icon> icon_;
     mutable std::shared_ptr<albert::Download> download_;
 
+private:
+
+    friend class IconPrefetcher;
+    void loadIcon() const;
+    void setIcon(std::unique_ptr<albert::Icon>, qint64 bytes) const;
+    void addToGauge(const QString &name, qint64 delta) const;
+
+    qint64 bytes_;  // memory accounting
+    mutable qint64 icon_bytes_ = 0;
+    mutable bool download_pending_ = false;
+    qint64 trace_pid_ = 0;
+    qint64 trace_tid_ = 0;
+
 };
 
 
+// Picks the smallest image url at least 128px wide
+QString pickImageUrl(const QJsonArray &images);
+
+QString makeTrackDescription(const QJsonObject &track);
+
+// Followers and capitalized genres
+QString makeArtistDescription(const QJsonObject &artist);
+
+
 class TrackItem : public SpotifyItem
 {
 public:
     TrackItem(API&, const QJsonObject&);
+    TrackItem(API&,
+              const QString &spotify_id,
+              const QString &title,
+              const QString &description,
+              const QString &icon_url,
+              const QString &search_key = {});
     SearchType type() const override final;
     std::vector<albert::Action> actions() const override;
 };
@@ -0,0 +1,595 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "api.h"
+#include "items.h"
+#include "library.h"
+#include "matcher.h"
+#include "normalize.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringTokenizer>
+#include <albert/app.h>
+#include <albert/logging.h>
+#include <algorithm>
+#include <deque>
+using namespace Qt::StringLiterals;
+using namespace albert;
+using namespace std;
+
+static const auto saved_tracks = u"tracks"_s;
+static const auto playlist_prefix = u"playlist:"_s;
+static const uint page_size = 50;
+static const uint playlist_items_page_size = 100;
+static const auto sync_window = 2u;  // requests queued at the rate limiter at most
+static const auto scheduler_interval = 1min;
+static const auto idle_threshold = 30s;  // without interactive requests
+static const auto initial_sync_delay = 10s;
+static const chrono::minutes min_sync_interval = 10min;
+static const chrono::minutes default_sync_interval = 1h;
+static const chrono::minutes max_sync_interval = 12h;
+
+static QString libraryPath()
+{ return QDir(app().cacheLocation() / "spotify").filePath(u"library.bin"_s); }
+
+static QString makeKey(const QString &name, const QString &description)
+{ return normalizeSearchKey(name + QChar::Space + description); }
+
+static LibraryRecord makeTrackRecord(const QJsonObject &track)
+{
+    LibraryRecord r{
+        .id = track["id"_L1].toString(),
+        .name = track["name"_L1].toString(),
+        .description = makeTrackDescription(track),
+        .image_url = pickImageUrl(track["album"_L1]["images"_L1].toArray()),
+        .key = {}
+    };
+    r.key = makeKey(r.name, r.description);
+    return r;
+}
+
+// Saved tracks and playlist items wrap the track. Skips local files and episodes.
+static void appendTrack(vector<LibraryRecord> &records, const QJsonValue &item)
+{
+    if (const auto track = item["track"_L1].toObject();
+        track["type"_L1].toString() == "track"_L1 && !track["id"_L1].isNull())
+        records.emplace_back(makeTrackRecord(track));
+}
+
+static void appendTracks(vector<LibraryRecord> &records, const QJsonArray &items)
+{
+    for (const auto &item : items)
+        appendTrack(records, item);
+}
+
+// Client errors retrying does not resolve, e.g. 404 on playlists not accessible to apps
+static bool isPermanentError(int status)
+{ return status >= 400 && status < 500 && status != 401 && status != 408 && status != 429; }
+
+Library::Library(API &api) :
+    api_(api),
+    alive_(make_shared<bool>(true)),
+    units_{{{"saved tracks", &Library::syncSavedTracks, default_sync_interval, {}},
+            {"playlists", &Library::syncPlaylists, default_sync_interval, {}}}}
+{
+    sync_timer_.setInterval(scheduler_interval);
+    connect(&sync_timer_, &QTimer::timeout, this, &Library::sync);
+
+    connect(&api_.oauth, &OAuth2::stateChanged, this, [this] {
+        if (api_.oauth.state() == OAuth2::State::Granted)
+        {
+            for (auto &unit : units_)
+                unit.due = QDeadlineTimer(0);
+            QTimer::singleShot(initial_sync_delay, this, &Library::sync);
+            sync_timer_.start();
+        }
+        else
+            sync_timer_.stop();
+    });
+}
+
+Library::~Library()
+{
+    *alive_ = false;  // pending syncs must not touch this anymore
+    api_.metrics.addToGauge(u"library records"_s, -gauge_records_);
+    api_.metrics.addToGauge(u"library mapped bytes"_s, -gauge_bytes_);
+}
+
+void Library::load()
+{
+    // Superseded by the binary format
+    QFile::remove(QDir(app().cacheLocation() / "spotify").filePath(u"library.json"_s));
+
+    QWriteLocker locker(&file_lock_);
+    if (file_.open(libraryPath()))
+    {
+        updateGauges();
+        DEBG << "Mapped" << size() << "library records.";
+    }
+}
+
+QString Library::snapshot(const QString &collection) const
+{
+    const auto *c = file_.findCollection(collection);
+    return c ? file_.string(c->snapshot).toString() : QString{};
+}
+
+uint Library::itemCount(const QString &collection) const
+{
+    const auto *c = file_.findCollection(collection);
+    return c ? c->item_count : 0;
+}
+
+vector<LibraryRecord> Library::records(const QString &collection) const
+{
+    vector<LibraryRecord> records;
+    if (const auto *c = file_.findCollection(collection))
+    {
+        records.reserve(c->record_count);
+        for (const auto &r : file_.records().subspan(c->first_record, c->record_count))
+        {
+            const auto v = file_.view(r);
+            records.emplace_back(LibraryRecord{.id = v.id.toString(),
+                                               .name = v.name.toString(),
+                                               .description = v.description.toString(),
+                                               .image_url = v.image_url.toString(),
+                                               .key = v.key.toString()});
+        }
+    }
+    return records;
+}
+
+void Library::commit(LibraryChanges &&changes)
+{
+    LibraryFile::Writer writer;
+
+    // Unchanged collections are copied from the mapped file
+    for (const auto &c : file_.collections())
+        if (const auto id = file_.string(c.id); !changes.contains(id.toString()))
+        {
+            writer.addCollection(id, file_.string(c.snapshot), c.item_count);
+            for (const auto &r : file_.records().subspan(c.first_record, c.record_count))
+                writer.addRecord(file_.view(r));
+        }
+
+    for (const auto &[id, c] : changes)
+        if (c)
+        {
+            writer.addCollection(id, c->snapshot, c->item_count);
+            for (const auto &r : c->records)
+                writer.addRecord({r.id, r.name, r.description, r.image_url, r.key});
+        }
+
+    QDir().mkpath(QFileInfo(libraryPath()).path());
+    if (writer.write(libraryPath()))
+    {
+        {
+            QWriteLocker locker(&file_lock_);
+            file_.open(libraryPath());  // replaces the old mapping
+        }
+        updateGauges();
+        emit changed();
+    }
+}
+
+bool Library::isSyncing() const { return syncing_; }
+
+void Library::sync()
+{
+    if (syncing_ || api_.oauth.state() != OAuth2::State::Granted || !api_.isIdle(idle_threshold))
+        return;
+
+    // Most overdue first
+    const auto it = ranges::min_element(units_, {}, [](const auto &u) { return u.due.deadlineNSecs(); });
+    if (!it->due.hasExpired())
+        return;
+
+    syncing_ = true;
+    QCoro::connect(syncUnit(static_cast<size_t>(it - units_.begin())), this, [this] { syncing_ = false; });
+}
+
+QCoro::Task<> Library::syncUnit(size_t index)
+{
+    const auto alive = alive_;
+
+    const auto result = co_await (this->*units_[index].sync)();
+    if (!*alive)
+        co_return;
+
+    auto &unit = units_[index];
+    switch (result) {
+    using enum SyncResult;
+    case Changed:
+        unit.interval = max(unit.interval / 2, min_sync_interval);
+        break;
+    case Unchanged:
+        unit.interval = min(unit.interval * 2, max_sync_interval);
+        break;
+    case Failed:
+        if (!api_.isIdle(idle_threshold))
+        {
+            DEBG << "Syncing" << unit.name << "interrupted by interactive use.";
+            co_return;  // still due, resumes on the next idle tick
+        }
+        WARN << "Failed syncing" << unit.name;
+        unit.due = QDeadlineTimer(min_sync_interval);
+        co_return;
+    }
+
+    // Collections matching more queries are synced more often, up to twice the base rate
+    quint64 total_hits = 0;
+    for (const auto &u : units_)
+        total_hits += u.hits;
+    const auto share = total_hits ? static_cast<double>(unit.hits) / static_cast<double>(total_hits) : .5;
+    const auto next = chrono::duration_cast<chrono::milliseconds>(unit.interval * (1.5 - share));
+
+    unit.due = QDeadlineTimer(next);
+    DEBG << "Next" << unit.name << "sync in" << chrono::duration_cast<chrono::minutes>(next).count() << "min.";
+}
+
+size_t Library::size() const { return file_.records().size(); }
+
+vector<LibraryMatch> Library::match(const QString &query, size_t limit, QDeadlineTimer deadline) const
+{
+    static constexpr size_t deadline_check_interval = 1024;
+
+    vector<LibraryMatch> matches;
+
+    const auto normalized = normalizeSearchKey(query);
+    vector<QStringView> words;
+    for (const auto word : QStringTokenizer(normalized, QChar::Space, Qt::SkipEmptyParts))
+        words.emplace_back(word);
+    if (words.empty() || limit == 0)
+        return matches;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QReadLocker locker(&file_lock_);
+    const auto records = file_.records();
+
+    // Top k in a min heap. Strings are deduplicated in the file, hence tracks in several
+    // collections share the id offset.
+    struct Candidate
+    {
+        const LibraryFile::Record *record;
+        int score;
+    };
+    vector<Candidate> candidates;
+    const auto worse = [](const auto &a, const auto &b) { return a.score > b.score; };
+    QSet<quint32> ids;
+    size_t scanned = 0;
+    for (; scanned < records.size(); ++scanned)
+    {
+        if (scanned % deadline_check_interval == 0 && scanned && deadline.hasExpired())
+            break;
+
+        const auto &r = records[scanned];
+        if (const auto score = matcher::score(file_.string(r.key), words);
+            score >= 0 && (candidates.size() < limit || score > candidates.front().score)
+            && !ids.contains(r.id.offset))
+        {
+            ids.insert(r.id.offset);
+            if (candidates.size() == limit)
+            {
+                ranges::pop_heap(candidates, worse);
+                candidates.pop_back();
+            }
+            candidates.push_back({&r, score});
+            ranges::push_heap(candidates, worse);
+        }
+    }
+
+    ranges::sort_heap(candidates, worse);
+
+    for (const auto &c : candidates)
+    {
+        const auto index = static_cast<quint32>(c.record - records.data());
+        if (const auto it = ranges::find_if(file_.collections(), [&](const auto &col) {
+                return index >= col.first_record && index < col.first_record + col.record_count;
+            });
+            it != file_.collections().end())
+            ++units_[file_.string(it->id) == saved_tracks ? 0 : 1].hits;
+    }
+
+    matches.reserve(candidates.size());
+    for (const auto &[r, score] : candidates)
+    {
+        const auto v = file_.view(*r);
+        matches.push_back({{.id = v.id.toString(),
+                            .name = v.name.toString(),
+                            .description = v.description.toString(),
+                            .image_url = v.image_url.toString(),
+                            .key = v.key.toString()},
+                           score});
+    }
+
+    DEBG << u"Scanned %1 of %2 records in %3 µs (%4)."_s
+                .arg(scanned).arg(records.size()).arg(timer.nsecsElapsed() / 1000).arg(matcher::kernel());
+
+    return matches;
+}
+
+void Library::updateGauges()
+{
+    const auto records = static_cast<qint64>(file_.records().size());
+    const auto bytes = file_.size();
+    api_.metrics.addToGauge(u"library records"_s, records - gauge_records_);
+    api_.metrics.addToGauge(u"library mapped bytes"_s, bytes - gauge_bytes_);
+    gauge_records_ = records;
+    gauge_bytes_ = bytes;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+QCoro::Task<expected<QJsonDocument, QString>> Library::fetchPage(PageRequest request, uint offset)
+{
+    const auto alive = alive_;
+
+    auto exp_doc = co_await request(offset);
+    if (!*alive)
+        co_return unexpected(u"Library destroyed."_s);
+
+    co_return exp_doc;
+}
+
+QCoro::Task<expected<vector<QJsonArray>, QString>>
+Library::fetchRemainingPages(PageRequest request, uint page_size, uint total)
+{
+    const auto alive = alive_;
+
+    vector<uint> offsets;
+    for (uint offset = page_size; offset < total; offset += page_size)
+        offsets.emplace_back(offset);
+
+    // Issue the requests concurrently, the API paces them. Keep only a few queued at the rate
+    // limiter though, interactive requests must not wait behind a whole library sync.
+    vector<QJsonArray> pages;
+    pages.reserve(offsets.size());
+    deque<API::Reply> window;
+    for (size_t issued = 0; pages.size() < offsets.size();)
+    {
+        while (issued < offsets.size() && window.size() < sync_window)
+            window.emplace_back(request(offsets[issued++]));
+
+        const auto exp_doc = co_await ::move(window.front());
+        window.pop_front();
+        if (!*alive)
+            co_return unexpected(u"Library destroyed."_s);
+
+        if (exp_doc)
+            pages.emplace_back((*exp_doc)["items"_L1].toArray());
+        else
+            co_return unexpected(exp_doc.error());
+    }
+
+    co_return pages;
+}
+
+API::Validator Library::idle() const
+{
+    // Background requests yield to interactive ones
+    return [&api = api_, alive = alive_] { return *alive && api.isIdle(idle_threshold); };
+}
+
+QCoro::Task<Library::SyncResult> Library::syncSavedTracks()
+{
+    const auto alive = alive_;
+    const auto request = [this](uint offset) { return api_.userTracks(page_size, offset, idle()); };
+
+    auto exp_doc = co_await fetchPage(request, 0);
+    if (!*alive)
+        co_return SyncResult::Failed;
+    if (!exp_doc)
+    {
+        DEBG << "Failed syncing saved tracks:" << exp_doc.error();
+        co_return SyncResult::Failed;
+    }
+
+    const auto total = static_cast<uint>((*exp_doc)["total"_L1].toInt());
+    const auto first_page = (*exp_doc)["items"_L1].toArray();
+    const auto newest = first_page.isEmpty() ? QString{} : first_page.first()["added_at"_L1].toString();
+
+    if (snapshot(saved_tracks) == newest && itemCount(saved_tracks) == total)
+    {
+        DEBG << "Saved tracks unchanged.";
+        co_return SyncResult::Unchanged;
+    }
+
+    // Incremental sync: tracks are ordered by added_at descending.
+    // Fetch pages until the latest known track is reached.
+    if (const auto known_newest = snapshot(saved_tracks); !known_newest.isEmpty())
+    {
+        vector<LibraryRecord> added;
+        uint added_items = 0;  // including skipped ones
+        auto page = first_page;
+        for (uint offset = 0;;)
+        {
+            bool reached_known = false;
+            for (const auto &item : page)
+            {
+                // ISO 8601 UTC timestamps compare lexicographically
+                if (item["added_at"_L1].toString() <= known_newest)
+                {
+                    reached_known = true;
+                    break;
+                }
+                ++added_items;
+                appendTrack(added, item);
+            }
+
+            if (reached_known || static_cast<uint>(page.size()) < page_size)
+                break;
+
+            offset += page_size;
+            exp_doc = co_await fetchPage(request, offset);
+            if (!*alive)
+                co_return SyncResult::Failed;
+            if (!exp_doc)
+            {
+                DEBG << "Failed syncing saved tracks:" << exp_doc.error();
+                co_return SyncResult::Failed;
+            }
+            page = (*exp_doc)["items"_L1].toArray();
+        }
+
+        // Removals are not detectable incrementally, resync fully if the numbers do not add up
+        if (itemCount(saved_tracks) + added_items == total)
+        {
+            DEBG << "Added" << added.size() << "saved tracks.";
+            auto known = records(saved_tracks);
+            added.insert(added.end(), make_move_iterator(known.begin()), make_move_iterator(known.end()));
+            LibraryChanges changes;
+            changes.emplace(saved_tracks, LibraryCollection{newest, total, ::move(added)});
+            commit(::move(changes));
+            co_return SyncResult::Changed;
+        }
+
+        DEBG << "Saved tracks have been removed, syncing fully.";
+    }
+
+    // Full sync: total is known after the first page
+    const auto exp_pages = co_await fetchRemainingPages(request, page_size, total);
+    if (!*alive)
+        co_return SyncResult::Failed;
+    if (!exp_pages)
+    {
+        DEBG << "Failed syncing saved tracks:" << exp_pages.error();
+        co_return SyncResult::Failed;
+    }
+
+    vector<LibraryRecord> records;
+    records.reserve(total);
+    appendTracks(records, first_page);
+    for (const auto &page : *exp_pages)
+        appendTracks(records, page);
+
+    DEBG << "Synced" << records.size() << "saved tracks.";
+    LibraryChanges changes;
+    changes.emplace(saved_tracks, LibraryCollection{newest, total, ::move(records)});
+    commit(::move(changes));
+    co_return SyncResult::Changed;
+}
+
+QCoro::Task<Library::SyncResult> Library::syncPlaylists()
+{
+    const auto alive = alive_;
+
+    // List the playlists and their snapshot ids
+    const auto list_request = [this](uint offset) { return api_.userPlaylists(page_size, offset, idle()); };
+    auto exp_doc = co_await fetchPage(list_request, 0);
+    if (!*alive)
+        co_return SyncResult::Failed;
+    if (!exp_doc)
+    {
+        DEBG << "Failed listing playlists:" << exp_doc.error();
+        co_return SyncResult::Failed;
+    }
+
+    vector<QJsonArray> list_pages{(*exp_doc)["items"_L1].toArray()};
+    const auto total = static_cast<uint>((*exp_doc)["total"_L1].toInt());
+    const auto exp_pages = co_await fetchRemainingPages(list_request, page_size, total);
+    if (!*alive)
+        co_return SyncResult::Failed;
+    if (!exp_pages)
+    {
+        DEBG << "Failed listing playlists:" << exp_pages.error();
+        co_return SyncResult::Failed;
+    }
+    list_pages.insert(list_pages.end(), exp_pages->begin(), exp_pages->end());
+
+    // Refetch the items of playlists with changed snapshot ids only
+    QSet<QString> current;
+    LibraryChanges changes;
+    uint failures = 0;  // keep their stored items, retried on the next sync
+
+    // Interactive use cancels the remaining requests as well, stop early but keep the progress
+    const auto interrupt = [this, &changes] {
+        if (!changes.empty())
+            commit(::move(changes));
+        return SyncResult::Failed;
+    };
+
+    for (const auto &page : list_pages)
+        for (const auto &playlist : page)
+        {
+            const auto id = playlist["id"_L1].toString();
+            const auto snapshot = playlist["snapshot_id"_L1].toString();
+            const auto key = playlist_prefix + id;
+            current.insert(key);
+
+            if (this->snapshot(key) == snapshot)
+                continue;
+
+            const auto request = [this, id](uint offset) {
+                return api_.playlistItems(id, playlist_items_page_size, offset, idle());
+            };
+
+            const auto diagnostics = make_shared<API::Diagnostics>();
+            auto exp_items = co_await fetchPage([this, id, diagnostics](uint offset) {
+                return api_.playlistItems(id, playlist_items_page_size, offset, idle(), diagnostics);
+            }, 0);
+            if (!*alive)
+                co_return SyncResult::Failed;
+            if (!exp_items)
+            {
+                DEBG << "Failed syncing playlist" << id << exp_items.error();
+                if (!api_.isIdle(idle_threshold))
+                    co_return interrupt();
+
+                // Store it empty, such that it is skipped until its snapshot changes
+                if (isPermanentError(diagnostics->status))
+                    changes.emplace(key, LibraryCollection{snapshot, 0, {}});
+                else
+                    ++failures;
+                continue;
+            }
+
+            const auto total = static_cast<uint>((*exp_items)["total"_L1].toInt());
+            const auto exp_item_pages = co_await fetchRemainingPages(request, playlist_items_page_size, total);
+            if (!*alive)
+                co_return SyncResult::Failed;
+            if (!exp_item_pages)
+            {
+                DEBG << "Failed syncing playlist" << id << exp_item_pages.error();
+                if (!api_.isIdle(idle_threshold))
+                    co_return interrupt();
+                ++failures;
+                continue;
+            }
+
+            vector<LibraryRecord> records;
+            records.reserve(total);
+            appendTracks(records, (*exp_items)["items"_L1].toArray());
+            for (const auto &items_page : *exp_item_pages)
+                appendTracks(records, items_page);
+
+            DEBG << "Synced" << records.size() << "tracks of playlist" << id;
+            changes.emplace(key, LibraryCollection{snapshot, total, ::move(records)});
+        }
+
+    // Drop playlists the user does not follow anymore
+    for (const auto &c : file_.collections())
+        if (const auto id = file_.string(c.id).toString();
+            id.startsWith(playlist_prefix) && !current.contains(id))
+            changes.emplace(id, nullopt);
+
+    const auto changed = !changes.empty();
+    if (changed)
+        commit(::move(changes));  // keep the progress, also if some playlists failed
+
+    if (failures)
+    {
+        DEBG << "Failed syncing" << failures << "playlists.";
+        co_return SyncResult::Failed;
+    }
+
+    if (!changed)
+        DEBG << "Playlists unchanged.";
+    co_return changed ? SyncResult::Changed : SyncResult::Unchanged;
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include "api.h"
+#include "libraryfile.h"
+#include <QCoroTask>
+#include <QJsonDocument>
+#include <QDeadlineTimer>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QString>
+#include <QTimer>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <expected>
+#include <functional>
+#include <map>
+#include <optional>
+#include <memory>
+#include <vector>
+class QJsonArray;
+
+struct LibraryRecord
+{
+    QString id;
+    QString name;
+    QString description;
+    QString image_url;
+    QString key;  // search key
+};
+
+// A synced collection, e.g. the saved tracks or the tracks of a playlist.
+struct LibraryCollection
+{
+    QString snapshot;  // change marker, latest added_at or playlist snapshot_id
+    uint item_count;   // API total, records skip local files and episodes
+    std::vector<LibraryRecord> records;
+};
+
+struct LibraryMatch
+{
+    LibraryRecord record;
+    int score;
+};
+
+// Collection changes, nullopt removes the collection.
+using LibraryChanges = std::map<QString, std::optional<LibraryCollection>>;
+
+// Local copy of the users library, searchable without network.
+class Library : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit Library(API &api);
+    ~Library() override;
+
+    // Maps the library file.
+    void load();
+
+    // Syncs the most overdue collection if the launcher is idle. No-op if a sync is in progress.
+    //
+    // Collections that changed are synced more often, unchanged ones less. Collections matching
+    // more queries get a shorter interval. Syncs stop as soon as interactive requests appear.
+    void sync();
+
+    [[nodiscard]] bool isSyncing() const;
+
+    // The best scored track records containing all words of the query, best first.
+    // Thread-safe. Stops scanning at the deadline and returns the best matches so far.
+    [[nodiscard]] std::vector<LibraryMatch> match(const QString &query, size_t limit,
+                                                  QDeadlineTimer = QDeadlineTimer::Forever) const;
+
+    [[nodiscard]] size_t size() const;
+
+signals:
+
+    void changed();
+
+private:
+
+    using PageRequest = std::function<QCoro::Task<std::expected<QJsonDocument, QString>>(uint offset)>;
+    QCoro::Task<std::expected<QJsonDocument, QString>> fetchPage(PageRequest, uint offset);
+    QCoro::Task<std::expected<std::vector<QJsonArray>, QString>>
+    fetchRemainingPages(PageRequest, uint page_size, uint total);
+
+    enum class SyncResult { Unchanged, Changed, Failed };
+    QCoro::Task<> syncUnit(size_t index);
+    QCoro::Task<SyncResult> syncSavedTracks();
+    QCoro::Task<SyncResult> syncPlaylists();
+    [[nodiscard]] API::Validator idle() const;
+    [[nodiscard]] QString snapshot(const QString &collection) const;
+    [[nodiscard]] uint itemCount(const QString &collection) const;
+    [[nodiscard]] std::vector<LibraryRecord> records(const QString &collection) const;
+
+    // Writes the library file with the changes applied and remaps it.
+    void commit(LibraryChanges &&);
+    void updateGauges();
+
+    API &api_;
+    LibraryFile file_;
+    mutable QReadWriteLock file_lock_;  // remapping vs. matching in other threads
+    std::shared_ptr<bool> alive_;
+    bool syncing_ = false;
+    QTimer sync_timer_;  // scheduler tick
+
+    struct SyncUnit
+    {
+        const char *name;
+        QCoro::Task<SyncResult> (Library::*sync)();
+        std::chrono::minutes interval;
+        QDeadlineTimer due;
+        mutable std::atomic<quint64> hits = 0;  // matched queries, counted in any thread
+    };
+    std::array<SyncUnit, 2> units_;  // saved tracks, playlists
+    qint64 gauge_records_ = 0;
+    qint64 gauge_bytes_ = 0;
+
+};
@@ -0,0 +1,198 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "libraryfile.h"
+#include <QSaveFile>
+#include <albert/logging.h>
+#include <cstring>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+namespace
+{
+
+static const char magic[4] = {'S', 'P', 'L', 'B'};
+static const quint32 format_version = 3;  // 2: normalized search keys, 3: item counts
+
+struct Header
+{
+    char magic[4];
+    quint32 version;
+    quint32 collection_count;
+    quint32 record_count;
+    quint64 string_count;  // UTF-16 code units
+};
+
+}
+
+void LibraryFile::Writer::addCollection(QStringView id, QStringView snapshot, quint32 item_count)
+{
+    collections_.push_back({
+        .id = addString(id),
+        .snapshot = addString(snapshot),
+        .first_record = static_cast<quint32>(records_.size()),
+        .record_count = 0,
+        .item_count = item_count
+    });
+}
+
+void LibraryFile::Writer::addRecord(const RecordView &r)
+{
+    Q_ASSERT(!collections_.empty());
+    records_.push_back({
+        .id = addString(r.id),
+        .name = addString(r.name),
+        .description = addString(r.description),
+        .image_url = addString(r.image_url),
+        .key = addString(r.key)
+    });
+    ++collections_.back().record_count;
+}
+
+LibraryFile::StringRef LibraryFile::Writer::addString(QStringView s)
+{
+    // Deduplicate, e.g. artists, album art and tracks in several playlists
+    if (const auto it = string_index_.constFind(s); it != string_index_.cend())
+        return *it;
+
+    const StringRef ref{static_cast<quint32>(strings_.size()), static_cast<quint32>(s.size())};
+    strings_.insert(strings_.end(), s.utf16(), s.utf16() + s.size());
+    string_index_.insert(s, ref);
+    return ref;
+}
+
+bool LibraryFile::Writer::write(const QString &path)
+{
+    const Header header{
+        .magic = {magic[0], magic[1], magic[2], magic[3]},
+        .version = format_version,
+        .collection_count = static_cast<quint32>(collections_.size()),
+        .record_count = static_cast<quint32>(records_.size()),
+        .string_count = strings_.size()
+    };
+
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)
+        && file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != -1
+        && file.write(reinterpret_cast<const char*>(collections_.data()),
+                      static_cast<qint64>(collections_.size() * sizeof(Collection))) != -1
+        && file.write(reinterpret_cast<const char*>(records_.data()),
+                      static_cast<qint64>(records_.size() * sizeof(Record))) != -1
+        && file.write(reinterpret_cast<const char*>(strings_.data()),
+                      static_cast<qint64>(strings_.size() * sizeof(char16_t))) != -1
+        && file.commit())
+        return true;
+
+    WARN << "Failed writing library file:" << file.errorString();
+    return false;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+LibraryFile::LibraryFile() = default;
+
+LibraryFile::~LibraryFile() = default;
+
+bool LibraryFile::open(const QString &path)
+{
+    close();
+
+    file_.setFileName(path);
+    if (!file_.exists())
+        return false;
+
+    if (!file_.open(QIODevice::ReadOnly))
+    {
+        WARN << "Failed opening library file:" << file_.errorString();
+        return false;
+    }
+
+    const auto file_size = static_cast<quint64>(file_.size());
+    if (file_size < sizeof(Header) || !(data_ = file_.map(0, file_.size())))
+    {
+        WARN << "Failed mapping library file:" << file_.errorString();
+        close();
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, data_, sizeof(Header));
+
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != format_version)
+    {
+        INFO << "Discarding library file of different format.";
+        close();
+        return false;
+    }
+
+    const auto collections_size = quint64(header.collection_count) * sizeof(Collection);
+    const auto records_size = quint64(header.record_count) * sizeof(Record);
+    const auto strings_size = header.string_count * sizeof(char16_t);
+    if (sizeof(Header) + collections_size + records_size + strings_size != file_size)
+    {
+        WARN << "Discarding corrupted library file.";
+        close();
+        return false;
+    }
+
+    auto *p = data_ + sizeof(Header);
+    collections_ = {reinterpret_cast<const Collection*>(p), header.collection_count};
+    p += collections_size;
+    records_ = {reinterpret_cast<const Record*>(p), header.record_count};
+    p += records_size;
+    strings_ = {reinterpret_cast<const char16_t*>(p), header.string_count};
+
+    for (const auto &c : collections_)
+        if (quint64(c.first_record) + c.record_count > header.record_count)
+        {
+            WARN << "Discarding corrupted library file.";
+            close();
+            return false;
+        }
+
+    return true;
+}
+
+void LibraryFile::close()
+{
+    if (data_)
+        file_.unmap(data_);
+    data_ = nullptr;
+    file_.close();
+    collections_ = {};
+    records_ = {};
+    strings_ = {};
+}
+
+bool LibraryFile::isOpen() const { return data_ != nullptr; }
+
+qint64 LibraryFile::size() const { return isOpen() ? file_.size() : 0; }
+
+span<const LibraryFile::Collection> LibraryFile::collections() const { return collections_; }
+
+span<const LibraryFile::Record> LibraryFile::records() const { return records_; }
+
+const LibraryFile::Collection *LibraryFile::findCollection(QStringView id) const
+{
+    for (const auto &c : collections_)
+        if (string(c.id) == id)
+            return &c;
+    return nullptr;
+}
+
+QStringView LibraryFile::string(StringRef ref) const
+{
+    if (quint64(ref.offset) + ref.size > strings_.size())
+        return {};
+    return QStringView(strings_.data() + ref.offset, ref.size);
+}
+
+LibraryFile::RecordView LibraryFile::view(const Record &r) const
+{
+    return {
+        .id = string(r.id),
+        .name = string(r.name),
+        .description = string(r.description),
+        .image_url = string(r.image_url),
+        .key = string(r.key)
+    };
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <span>
+#include <vector>
+
+// Memory-mapped, versioned binary library storage.
+//
+// Layout: Header | Collection[] | Record[] | UTF-16 string table
+//
+// Records of a collection are contiguous. Strings are shared across records and used in place.
+// The layout is native endian. Files of foreign byte order are rejected by the version check, since
+// the byte swapped version does not match.
+class LibraryFile
+{
+public:
+
+    struct StringRef
+    {
+        quint32 offset;  // in UTF-16 code units
+        quint32 size;
+    };
+
+    struct Collection
+    {
+        StringRef id;
+        StringRef snapshot;
+        quint32 first_record;
+        quint32 record_count;
+        quint32 item_count;  // API total, includes items not stored, e.g. local files
+    };
+
+    struct Record
+    {
+        StringRef id;
+        StringRef name;
+        StringRef description;
+        StringRef image_url;
+        StringRef key;  // precomputed search key
+    };
+
+    struct RecordView
+    {
+        QStringView id;
+        QStringView name;
+        QStringView description;
+        QStringView image_url;
+        QStringView key;
+    };
+
+    class Writer
+    {
+    public:
+        // Strings must stay valid until write() returns.
+        void addCollection(QStringView id, QStringView snapshot, quint32 item_count);
+        void addRecord(const RecordView &);
+        bool write(const QString &path);
+
+    private:
+        StringRef addString(QStringView);
+        std::vector<Collection> collections_;
+        std::vector<Record> records_;
+        std::vector<char16_t> strings_;
+        QHash<QStringView, StringRef> string_index_;
+    };
+
+    LibraryFile();
+    ~LibraryFile();
+
+    // Maps the file and validates its header. Returns false if missing or invalid.
+    bool open(const QString &path);
+    void close();
+
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] qint64 size() const;
+
+    [[nodiscard]] std::span<const Collection> collections() const;
+    [[nodiscard]] std::span<const Record> records() const;
+
+    [[nodiscard]] const Collection *findCollection(QStringView id) const;
+
+    // Out of range references yield empty strings
+    [[nodiscard]] QStringView string(StringRef) const;
+
+    [[nodiscard]] RecordView view(const Record &) const;
+
+private:
+
+    QFile file_;
+    uchar *data_ = nullptr;
+    std::span<const Collection> collections_;
+    std::span<const Record> records_;
+    std::span<const char16_t> strings_;
+
+};
@@ -0,0 +1,172 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "matcher.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define MATCHER_X86
+#if defined(__GNUC__)  // also clang
+#define MATCHER_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+using namespace std;
+
+namespace
+{
+
+using Kernel = qsizetype (*)(const char16_t *h, qsizetype h_size, const char16_t *n, qsizetype n_size);
+
+inline bool equalsInner(const char16_t *h, const char16_t *n, qsizetype n_size)
+{
+    // First and last code unit are known to match
+    return n_size <= 2 || memcmp(h + 1, n + 1, size_t(n_size - 2) * sizeof(char16_t)) == 0;
+}
+
+qsizetype findScalarFrom(const char16_t *h, qsizetype h_size, const char16_t *n, qsizetype n_size,
+                         qsizetype from)
+{
+    for (auto i = from; i + n_size <= h_size; ++i)
+        if (h[i] == n[0] && h[i + n_size - 1] == n[n_size - 1] && equalsInner(h + i, n, n_size))
+            return i;
+    return -1;
+}
+
+#if !defined(MATCHER_X86)
+qsizetype findScalar(const char16_t *h, qsizetype h_size, const char16_t *n, qsizetype n_size)
+{ return findScalarFrom(h, h_size, n, n_size, 0); }
+#endif
+
+// Compares the first and the last code unit of the needle against a block of candidate positions
+// at once and verifies the candidates only. See http://0x80.pl/articles/simd-strfind.html
+
+#if defined(MATCHER_X86)
+
+qsizetype findSse2(const char16_t *h, qsizetype h_size, const char16_t *n, qsizetype n_size)
+{
+    static constexpr qsizetype lanes = 8;
+    const auto first = _mm_set1_epi16(static_cast<short>(n[0]));
+    const auto last = _mm_set1_epi16(static_cast<short>(n[n_size - 1]));
+
+    qsizetype i = 0;
+    for (; i + n_size - 1 + lanes <= h_size; i += lanes)
+    {
+        const auto block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+        const auto block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + n_size - 1));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi16(first, block_first), _mm_cmpeq_epi16(last, block_last))));
+
+        while (mask)  // two bits per lane
+        {
+            const auto bit = countr_zero(mask);
+            if (const auto pos = i + bit / 2; equalsInner(h + pos, n, n_size))
+                return pos;
+            mask &= ~(3u << bit);
+        }
+    }
+
+    return findScalarFrom(h, h_size, n, n_size, i);
+}
+
+#if defined(MATCHER_AVX2)
+
+MATCHER_AVX2
+qsizetype findAvx2(const char16_t *h, qsizetype h_size, const char16_t *n, qsizetype n_size)
+{
+    static constexpr qsizetype lanes = 16;
+    const auto first = _mm256_set1_epi16(static_cast<short>(n[0]));
+    const auto last = _mm256_set1_epi16(static_cast<short>(n[n_size - 1]));
+
+    qsizetype i = 0;
+    for (; i + n_size - 1 + lanes <= h_size; i += lanes)
+    {
+        const auto block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i));
+        const auto block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i + n_size - 1));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi16(first, block_first),
+                             _mm256_cmpeq_epi16(last, block_last))));
+
+        while (mask)  // two bits per lane
+        {
+            const auto bit = countr_zero(mask);
+            if (const auto pos = i + bit / 2; equalsInner(h + pos, n, n_size))
+                return pos;
+            mask &= ~(3u << bit);
+        }
+    }
+
+    return findScalarFrom(h, h_size, n, n_size, i);
+}
+
+#endif
+#endif
+
+struct Dispatch
+{
+    Kernel find;
+    const char *name;
+};
+
+Dispatch select()
+{
+#if defined(MATCHER_X86)
+#if defined(MATCHER_AVX2)
+    if (__builtin_cpu_supports("avx2"))
+        return {findAvx2, "avx2"};
+#endif
+    return {findSse2, "sse2"};  // x86-64 baseline
+#else
+    return {findScalar, "scalar"};
+#endif
+}
+
+const Dispatch &dispatch()
+{
+    static const auto d = select();
+    return d;
+}
+
+}
+
+qsizetype matcher::indexOf(QStringView haystack, QStringView needle)
+{
+    if (needle.isEmpty())
+        return 0;
+    if (needle.size() > haystack.size())
+        return -1;
+    return dispatch().find(reinterpret_cast<const char16_t*>(haystack.utf16()), haystack.size(),
+                           reinterpret_cast<const char16_t*>(needle.utf16()), needle.size());
+}
+
+int matcher::score(QStringView key, span<const QStringView> words)
+{
+    static constexpr int max_length_penalty = 1023;
+
+    int score = 0;
+    for (const auto &word : words)
+    {
+        auto pos = indexOf(key, word);
+        if (pos < 0)
+            return -1;
+
+        // Prefer a hit at a word start, e.g. "foo" in "xfoo foo"
+        while (pos > 0 && key[pos - 1] != QChar::Space)
+            if (const auto next = indexOf(key.sliced(pos + 1), word); next >= 0)
+                pos += 1 + next;
+            else
+                break;
+
+        if (pos == 0)
+            score += 3;
+        else if (key[pos - 1] == QChar::Space)
+            score += 2;
+        else
+            score += 1;
+    }
+
+    return score * (max_length_penalty + 1)
+           - static_cast<int>(min<qsizetype>(key.size(), max_length_penalty));
+}
+
+const char *matcher::kernel() { return dispatch().name; }
@@ -0,0 +1,25 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QStringView>
+#include <span>
+
+// Substring matching over precomputed search keys.
+//
+// The search kernel is vectorized (AVX2, SSE2) where available and picked at runtime,
+// other platforms use a scalar fallback.
+namespace matcher
+{
+
+// Index of the first occurrence of needle in haystack, -1 if not found.
+qsizetype indexOf(QStringView haystack, QStringView needle);
+
+// Scores a key against the query words, -1 if any word is missing.
+// Matches at the start of the key or of a word and shorter keys score higher. Scores the best
+// occurrence of each word.
+int score(QStringView key, std::span<const QStringView> words);
+
+// Name of the kernel in use.
+const char *kernel();
+
+}
@@ -0,0 +1,266 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "metrics.h"
+#include <QDateTime>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStringList>
+#include <albert/app.h>
+#include <albert/logging.h>
+#include <bit>
+using namespace Qt::StringLiterals;
+using namespace albert;
+using namespace std::chrono;
+using namespace std;
+
+static const array<const char*, static_cast<size_t>(Metrics::Stage::Count_)> stage_names {
+    "limiter",
+    "fetch",
+    "connect",
+    "server",
+    "download",
+    "parse",
+    "items",
+    "total"
+};
+
+static const array<const char*, static_cast<size_t>(Metrics::Counter::Count_)> counter_names {
+    "requests",
+    "bytes",
+    "wire_bytes",
+    "network_errors",
+    "unauthorized",
+    "rate_limited",
+    "client_errors",
+    "server_errors",
+    "parse_errors",
+    "deduplicated"
+};
+
+void Histogram::add(nanoseconds d)
+{
+    const auto us = static_cast<quint64>(std::max<qint64>(duration_cast<microseconds>(d).count(), 0));
+    const auto bucket = std::min<size_t>(bit_width(us), buckets_.size() - 1);
+    ++buckets_[bucket];
+    ++count_;
+    sum_ += d;
+    max_ = std::max(max_, d);
+}
+
+quint64 Histogram::count() const { return count_; }
+
+nanoseconds Histogram::mean() const { return count_ ? sum_ / count_ : nanoseconds{}; }
+
+nanoseconds Histogram::max() const { return max_; }
+
+nanoseconds Histogram::percentile(double q) const
+{
+    if (count_ == 0)
+        return {};
+
+    const auto rank = static_cast<quint64>(q * static_cast<double>(count_ - 1)) + 1;
+    quint64 cumulative = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i)
+        if (cumulative += buckets_[i]; cumulative >= rank)
+            return std::min(duration_cast<nanoseconds>(microseconds(1ull << i)), max_);
+    return max_;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void Metrics::addEndpointTiming(const QString &endpoint, Stage stage, nanoseconds d)
+{
+    QMutexLocker l(&mutex_);
+    endpoint_timings_[endpoint][static_cast<size_t>(stage)].add(d);
+}
+
+void Metrics::addHandlerTiming(const QString &handler, Stage stage, nanoseconds d)
+{
+    QMutexLocker l(&mutex_);
+    handler_timings_[handler][static_cast<size_t>(stage)].add(d);
+}
+
+void Metrics::increment(const QString &endpoint, Counter counter, quint64 n)
+{
+    QMutexLocker l(&mutex_);
+    counters_[endpoint][static_cast<size_t>(counter)] += n;
+}
+
+void Metrics::addToGauge(const QString &gauge, qint64 delta)
+{
+    QMutexLocker l(&mutex_);
+    auto &g = gauges_[gauge];
+    g.value += delta;
+    g.high_water_mark = std::max(g.high_water_mark, g.value);
+}
+
+void Metrics::addCacheLookup(const QString &cache, bool hit)
+{
+    QMutexLocker l(&mutex_);
+    auto &c = caches_[cache];
+    ++(hit ? c.hits : c.misses);
+}
+
+const map<QString, Metrics::Timings> &Metrics::endpointTimings() const { return endpoint_timings_; }
+
+const map<QString, Metrics::Timings> &Metrics::handlerTimings() const { return handler_timings_; }
+
+const map<QString, Metrics::Counters> &Metrics::counters() const { return counters_; }
+
+const map<QString, Metrics::Gauge> &Metrics::gauges() const { return gauges_; }
+
+const map<QString, Metrics::CacheStats> &Metrics::caches() const { return caches_; }
+
+static QString formatDuration(nanoseconds d)
+{
+    if (d < 1ms)
+        return u"%1µs"_s.arg(duration_cast<microseconds>(d).count());
+    if (d < 10s)
+        return u"%1ms"_s.arg(duration_cast<microseconds>(d).count() / 1000., 0, 'f', 1);
+    return u"%1s"_s.arg(duration_cast<milliseconds>(d).count() / 1000., 0, 'f', 1);
+}
+
+static void appendTimings(QStringList &lines, const map<QString, Metrics::Timings> &timings)
+{
+    for (const auto &[key, histograms] : timings)
+    {
+        lines << key;
+        for (size_t i = 0; i < histograms.size(); ++i)
+            if (const auto &h = histograms[i]; h.count())
+                lines << u"  %1 n=%2 mean=%3 p50=%4 p99=%5 max=%6"_s
+                             .arg(QString::fromLatin1(stage_names[i]), -9)
+                             .arg(h.count(), -5)
+                             .arg(formatDuration(h.mean()), -8)
+                             .arg(formatDuration(h.percentile(.5)), -8)
+                             .arg(formatDuration(h.percentile(.99)), -8)
+                             .arg(formatDuration(h.max()));
+    }
+}
+
+QString Metrics::report() const
+{
+    QMutexLocker l(&mutex_);
+    QStringList lines;
+
+    lines << u"Counters"_s;
+    for (const auto &[endpoint, counters] : counters_)
+    {
+        QStringList values;
+        for (size_t i = 0; i < counters.size(); ++i)
+            if (counters[i])
+                values << u"%1=%2"_s.arg(QString::fromLatin1(counter_names[i])).arg(counters[i]);
+        lines << u"  %1 %2"_s.arg(endpoint, values.join(u' '));
+    }
+
+    lines << QString{} << u"Gauges"_s;
+    for (const auto &[name, gauge] : gauges_)
+        lines << u"  %1 value=%2 max=%3"_s.arg(name).arg(gauge.value).arg(gauge.high_water_mark);
+
+    lines << QString{} << u"Caches"_s;
+    for (const auto &[name, c] : caches_)
+        lines << u"  %1 hits=%2 misses=%3 ratio=%4%"_s
+                     .arg(name).arg(c.hits).arg(c.misses)
+                     .arg(100. * c.hits / std::max<quint64>(c.hits + c.misses, 1), 0, 'f', 1);
+
+    lines << QString{} << u"Endpoints"_s;
+    appendTimings(lines, endpoint_timings_);
+    lines << QString{} << u"Handlers"_s;
+    appendTimings(lines, handler_timings_);
+    return lines.join(u'\n');
+}
+
+static qint64 us(nanoseconds d) { return duration_cast<microseconds>(d).count(); }
+
+static QJsonObject toJson(const map<QString, Metrics::Timings> &timings)
+{
+    QJsonObject object;
+    for (const auto &[key, histograms] : timings)
+    {
+        QJsonObject stages;
+        for (size_t i = 0; i < histograms.size(); ++i)
+            if (const auto &h = histograms[i]; h.count())
+                stages.insert(QString::fromLatin1(stage_names[i]), QJsonObject{
+                    {u"count"_s, static_cast<qint64>(h.count())},
+                    {u"mean_us"_s, us(h.mean())},
+                    {u"p50_us"_s, us(h.percentile(.5))},
+                    {u"p99_us"_s, us(h.percentile(.99))},
+                    {u"max_us"_s, us(h.max())}
+                });
+        object.insert(key, stages);
+    }
+    return object;
+}
+
+QJsonObject Metrics::toJson() const
+{
+    QMutexLocker l(&mutex_);
+    QJsonObject counters;
+    for (const auto &[endpoint, values] : counters_)
+    {
+        QJsonObject o;
+        for (size_t i = 0; i < values.size(); ++i)
+            o.insert(QString::fromLatin1(counter_names[i]), static_cast<qint64>(values[i]));
+        counters.insert(endpoint, o);
+    }
+
+    QJsonObject gauges;
+    for (const auto &[name, gauge] : gauges_)
+        gauges.insert(name, QJsonObject{{u"value"_s, gauge.value},
+                                        {u"max"_s, gauge.high_water_mark}});
+
+    QJsonObject caches;
+    for (const auto &[name, c] : caches_)
+        caches.insert(name, QJsonObject{{u"hits"_s, static_cast<qint64>(c.hits)},
+                                        {u"misses"_s, static_cast<qint64>(c.misses)}});
+
+    return {
+        {u"counters"_s, counters},
+        {u"gauges"_s, gauges},
+        {u"caches"_s, caches},
+        {u"endpoints"_s, ::toJson(endpoint_timings_)},
+        {u"handlers"_s, ::toJson(handler_timings_)}
+    };
+}
+
+QString Metrics::save() const
+{
+    const auto dir = QDir(app().cacheLocation() / "spotify" / "metrics");
+    if (!dir.mkpath(u"."_s))
+    {
+        WARN << "Failed creating directory" << dir.path();
+        return {};
+    }
+
+    const auto name = QDateTime::currentDateTime().toString(u"yyyyMMdd-hhmmss"_s) + u".json"_s;
+    QSaveFile file(dir.filePath(name));
+    if (file.open(QIODevice::WriteOnly)
+        && file.write(QJsonDocument(toJson()).toJson()) != -1
+        && file.commit())
+    {
+        INFO << "Wrote metrics to" << file.fileName();
+        return file.fileName();
+    }
+
+    WARN << "Failed writing metrics:" << file.errorString();
+    return {};
+}
+
+void Metrics::log() const
+{
+    for (const auto &line : report().split(u'\n'))
+        INFO << line;
+}
+
+void Metrics::reset()
+{
+    QMutexLocker l(&mutex_);
+    endpoint_timings_.clear();
+    handler_timings_.clear();
+    counters_.clear();
+    caches_.clear();
+    // Gauges track live state
+    for (auto &[name, gauge] : gauges_)
+        gauge.high_water_mark = gauge.value;
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+#include <array>
+#include <chrono>
+#include <map>
+
+// Log-linear latency histogram with power of two microsecond buckets.
+class Histogram
+{
+public:
+
+    void add(std::chrono::nanoseconds);
+
+    [[nodiscard]] quint64 count() const;
+    [[nodiscard]] std::chrono::nanoseconds mean() const;
+    [[nodiscard]] std::chrono::nanoseconds max() const;
+
+    // Upper bound of the bucket containing the q-quantile, clamped to max.
+    [[nodiscard]] std::chrono::nanoseconds percentile(double q) const;
+
+private:
+
+    std::array<quint64, 32> buckets_{};
+    quint64 count_ = 0;
+    std::chrono::nanoseconds sum_{};
+    std::chrono::nanoseconds max_{};
+
+};
+
+
+class Metrics
+{
+public:
+
+    enum class Stage {
+        LimiterWait,  // waiting for the rate limiter
+        Fetch,        // awaiting the API result, including rate limiting and parsing
+        Connect,      // DNS lookup, TCP and TLS handshake, zero on reused connections
+        ServerWait,   // request sent until response headers arrived
+        Download,     // response headers until body completed
+        Parse,        // API::parseJson
+        Items,        // item construction in handleReply
+        Total,
+        Count_
+    };
+
+    enum class Counter {
+        Requests,
+        Bytes,            // decoded response body bytes
+        WireBytes,        // transferred response body bytes, if announced by Content-Length
+        NetworkErrors,    // no HTTP response, e.g. DNS, TLS or connection errors
+        Unauthorized,     // 401
+        RateLimited,      // 429
+        ClientErrors,     // other 4xx
+        ServerErrors,     // 5xx
+        ParseErrors,      // invalid JSON
+        Deduplicated,     // served by an identical request in flight
+        Count_
+    };
+
+    struct Gauge
+    {
+        qint64 value = 0;
+        qint64 high_water_mark = 0;
+    };
+
+    struct CacheStats
+    {
+        quint64 hits = 0;
+        quint64 misses = 0;
+    };
+
+    using Timings = std::array<Histogram, static_cast<size_t>(Stage::Count_)>;
+    using Counters = std::array<quint64, static_cast<size_t>(Counter::Count_)>;
+
+    void addEndpointTiming(const QString &endpoint, Stage, std::chrono::nanoseconds);
+    void addHandlerTiming(const QString &handler, Stage, std::chrono::nanoseconds);
+    void increment(const QString &endpoint, Counter, quint64 n = 1);
+    void addToGauge(const QString &gauge, qint64 delta);
+    void addCacheLookup(const QString &cache, bool hit);
+
+    // Recording, report(), toJson() and reset() are thread-safe, the accessors are not.
+    [[nodiscard]] const std::map<QString, Timings> &endpointTimings() const;
+    [[nodiscard]] const std::map<QString, Timings> &handlerTimings() const;
+    [[nodiscard]] const std::map<QString, Counters> &counters() const;
+    [[nodiscard]] const std::map<QString, Gauge> &gauges() const;
+    [[nodiscard]] const std::map<QString, CacheStats> &caches() const;
+
+    // Human readable plain text report.
+    [[nodiscard]] QString report() const;
+
+    [[nodiscard]] QJsonObject toJson() const;
+
+    // Writes toJson() to the cache. Returns the file path.
+    QString save() const;
+
+    void log() const;
+
+    void reset();
+
+private:
+
+    mutable QMutex mutex_;
+    std::map<QString, Timings> endpoint_timings_;
+    std::map<QString, Timings> handler_timings_;
+    std::map<QString, Counters> counters_;
+    std::map<QString, Gauge> gauges_;
+    std::map<QString, CacheStats> caches_;
+
+};
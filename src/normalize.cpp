@@ -0,0 +1,32 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "normalize.h"
+
+static const char16_t combining_voiced_mark = 0x3099;
+static const char16_t combining_semi_voiced_mark = 0x309A;
+static const char16_t katakana_first = 0x30A1;  // ァ
+static const char16_t katakana_last = 0x30F6;  // ヶ
+static const char16_t katakana_hiragana_offset = 0x60;
+
+QString normalizeSearchKey(const QString &string)
+{
+    // NFKD folds width variants and splits base characters from their diacritics
+    const auto decomposed = string.normalized(QString::NormalizationForm_KD);
+
+    QString folded;
+    folded.reserve(decomposed.size());
+    for (const auto c : decomposed)
+    {
+        const auto u = c.unicode();
+        if (c.category() == QChar::Mark_NonSpacing
+            && u != combining_voiced_mark && u != combining_semi_voiced_mark)
+            continue;
+        else if (u >= katakana_first && u <= katakana_last)
+            folded.append(QChar(u - katakana_hiragana_offset));
+        else
+            folded.append(c);
+    }
+
+    // Recompose kana with voicing marks and hangul syllables
+    return folded.toCaseFolded().normalized(QString::NormalizationForm_C);
+}
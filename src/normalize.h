@@ -0,0 +1,10 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QString>
+
+// Folds a string for locale independent matching.
+//
+// Applies compatibility decomposition (full-/half-width forms, ligatures), strips diacritics,
+// case folds and maps katakana to hiragana. Kana voicing marks are kept and recomposed.
+QString normalizeSearchKey(const QString &);
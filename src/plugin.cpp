@@ -1,7 +1,18 @@
 // Copyright (c) 2025-2025 Manuel Schneider
 
+#include "items.h"
 #include "plugin.h"
+#include <QDir>
+#include <QFontDatabase>
+#include <QGroupBox>
+#include <QHBoxLayout>
+#include <QPlainTextEdit>
+#include <QPointer>
+#include <QPushButton>
+#include <QScrollBar>
 #include <QSettings>
+#include <QTimer>
+#include <QVBoxLayout>
 #include <albert/app.h>
 #include <albert/logging.h>
 #include <albert/oauthconfigwidget.h>
@@ -15,7 +26,17 @@ namespace
 {
 static const auto keychain_service = u"albert.spotify"_s;
 static const auto keychain_key = u"secrets"_s;
+static const auto ck_api_url = u"api_url"_s;
+static const auto ck_accounts_url = u"accounts_url"_s;
+static const auto ck_record_sessions = u"record_sessions"_s;
+static const auto ck_trace = u"trace"_s;
 static const auto sk_token_expiration = u"token_expiration"_s;
+static const auto sk_username = u"username"_s;
+static const auto sk_product = u"product"_s;
+static const auto warm_up_delay = 15s;  // after login, leave the startup traffic alone
+static const auto warm_up_interval = 30min;
+static const auto warm_up_idle_threshold = 30s;  // skipped if the user interacted recently
+static const auto icon_prune_delay = 30s;  // leave startup alone
 }
 
 
@@ -46,19 +67,65 @@ static const auto sk_token_expiration = u"token_expiration"_s;
 // };
 
 Plugin::Plugin() :
-    track_search_handler(api),
+    library(api),
+    track_search_handler(api, library),
     artist_search_hanlder(api),
     album_search_handler(api),
     playlist_search_handler(api),
     show_search_handler(api),
     episode_search_handler(api),
-    audiobook_search_handler(api)
-{}
+    audiobook_search_handler(api),
+    library_query_handler(api, library)
+{
+    startup_timer.start();
+
+    api.setCacheDirectory(QDir(app().cacheLocation() / "spotify" / "http").path());
+
+    // Empty query results of the triggers are fetched ahead of use
+    warm_up_timer.setInterval(warm_up_interval);
+    connect(&warm_up_timer, &QTimer::timeout, this, [this] { QCoro::connect(warmUp(), this, [] {}); });
+    connect(&api.oauth, &OAuth2::stateChanged, this, [this] {
+        if (api.oauth.state() == OAuth2::State::Granted)
+        {
+            QTimer::singleShot(warm_up_delay, this, [this] { QCoro::connect(warmUp(), this, [] {}); });
+            warm_up_timer.start();
+        }
+        else
+            warm_up_timer.stop();
+    });
+}
 
 Plugin::~Plugin() = default;
 
 void Plugin::initialize()
 {
+    {
+        const auto s = settings();
+        if (s->contains(ck_api_url))
+            api.setApiUrl(s->value(ck_api_url).toUrl());
+        if (s->contains(ck_accounts_url))
+            api.setAccountsUrl(s->value(ck_accounts_url).toUrl());
+        api.recorder.setEnabled(s->value(ck_record_sessions, false).toBool());
+        api.tracer.setEnabled(s->value(ck_trace, false).toBool());
+    }
+
+    {
+        const auto s = state();
+        api.restoreAccountInformation(s->value(sk_username).toString(),
+                                      s->value(sk_product).toString());
+    }
+
+    library.load();
+
+    // In the thread that downloads and loads the icons
+    QTimer::singleShot(icon_prune_delay, this, &SpotifyItem::pruneIcons);
+
+    api.account_information_changed = [this] {
+        const auto s = state();
+        s->setValue(sk_username, api.username());
+        s->setValue(sk_product, api.product());
+    };
+
     auto *job = new QKeychain::ReadPasswordJob(keychain_service, this);  // Deletes itself
     job->setKey(keychain_key);
 
@@ -85,10 +152,16 @@ void Plugin::initialize()
         connect(&api.oauth, &OAuth2::clientSecretChanged, this, &Plugin::writeSecrets);
         connect(&api.oauth, &OAuth2::tokensChanged,       this, &Plugin::writeSecrets);
 
-        emit initialized();
+        api.setCredentialsLoaded();
+        DEBG << "Credentials loaded after" << startup_timer.elapsed() << "ms.";
     });
 
+    // Do not block on the keychain, it may take seconds, e.g. if locked.
+    // Handlers wait for the credentials on demand.
     job->start();
+
+    DEBG << "Initialized after" << startup_timer.elapsed() << "ms.";
+    emit initialized();
 }
 
 void Plugin::writeSecrets()
@@ -116,7 +189,57 @@ void Plugin::writeSecrets()
 
 QWidget *Plugin::buildConfigWidget()
 {
-    return new OAuthConfigWidget(api.oauth);
+    auto *w = new QWidget;
+    auto *l = new QVBoxLayout(w);
+    l->setContentsMargins(0, 0, 0, 0);
+    l->addWidget(new OAuthConfigWidget(api.oauth));
+
+    auto *box = new QGroupBox(tr("Statistics"));
+    auto *box_layout = new QVBoxLayout(box);
+    l->addWidget(box);
+
+    auto *text = new QPlainTextEdit;
+    text->setReadOnly(true);
+    text->setLineWrapMode(QPlainTextEdit::NoWrap);
+    text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    text->setPlainText(api.metrics.report());
+    box_layout->addWidget(text);
+
+    auto *buttons = new QHBoxLayout;
+    box_layout->addLayout(buttons);
+    buttons->addStretch();
+
+    auto *timer = new QTimer(text);
+    connect(timer, &QTimer::timeout, text, [this, text] {
+        const auto scroll_position = text->verticalScrollBar()->value();
+        text->setPlainText(api.metrics.report());
+        text->verticalScrollBar()->setValue(scroll_position);
+    });
+    timer->start(1s);
+
+    auto *button = new QPushButton(tr("Export"));
+    connect(button, &QPushButton::clicked, this, [this] { api.metrics.save(); });
+    buttons->addWidget(button);
+
+    button = new QPushButton(tr("Write to log"));
+    connect(button, &QPushButton::clicked, this, [this] { api.metrics.log(); });
+    buttons->addWidget(button);
+
+    if (api.tracer.isEnabled())
+    {
+        button = new QPushButton(tr("Save trace"));
+        connect(button, &QPushButton::clicked, this, [this] { api.tracer.save(); });
+        buttons->addWidget(button);
+    }
+
+    button = new QPushButton(tr("Reset"));
+    connect(button, &QPushButton::clicked, text, [this, text] {
+        api.metrics.reset();
+        text->setPlainText(api.metrics.report());
+    });
+    buttons->addWidget(button);
+
+    return w;
 }
 
 vector<Extension*> Plugin::extensions() {
@@ -128,11 +251,23 @@ vector<Extension*> Plugin::extensions() {
         &playlist_search_handler,
         &show_search_handler,
         &episode_search_handler,
-        &audiobook_search_handler
+        &audiobook_search_handler,
+        &library_query_handler
     };
 }
 
 
+QCoro::Task<> Plugin::warmUp()
+{
+    // Low priority, one request at a time. The handlers guard their own resumption.
+    QPointer<Plugin> self(this);
+    if (!api.isIdle(warm_up_idle_threshold))
+        co_return;
+    co_await track_search_handler.warmUp();
+    if (self && api.isIdle(warm_up_idle_threshold))
+        co_await artist_search_hanlder.warmUp();
+}
+
 void Plugin::handle(const QUrl &url)
 {
     api.oauth.handleCallback(url);
@@ -3,6 +3,9 @@
 #pragma once
 #include "api.h"
 #include "handlers.h"
+#include "library.h"
+#include <QElapsedTimer>
+#include <QTimer>
 #include <albert/extensionplugin.h>
 #include <albert/urlhandler.h>
 #include <vector>
@@ -25,8 +28,12 @@ public:
 private:
 
     void writeSecrets();
+    QCoro::Task<> warmUp();
 
+    QElapsedTimer startup_timer;
+    QTimer warm_up_timer;
     API api;
+    Library library;
 
     TrackSearchHandler track_search_handler;
     ArtistSearchHandler artist_search_hanlder;
@@ -35,5 +42,6 @@ private:
     ShowSearchHandler show_search_handler;
     EpisodeSearchHandler episode_search_handler;
     AudiobookSearchHandler audiobook_search_handler;
+    LibraryQueryHandler library_query_handler;
 
 };
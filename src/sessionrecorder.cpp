@@ -0,0 +1,65 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "sessionrecorder.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <albert/app.h>
+#include <albert/logging.h>
+using namespace Qt::StringLiterals;
+using namespace albert;
+using namespace std;
+
+SessionRecorder::SessionRecorder() = default;
+
+SessionRecorder::~SessionRecorder() = default;
+
+bool SessionRecorder::isEnabled() const { return file_ != nullptr; }
+
+void SessionRecorder::setEnabled(bool enabled)
+{
+    if (enabled == isEnabled())
+        return;
+
+    if (!enabled)
+    {
+        INFO << "Stopped recording sessions to" << file_->fileName();
+        file_.reset();
+        return;
+    }
+
+    const auto dir = QDir(app().cacheLocation() / "spotify" / "sessions");
+    if (!dir.mkpath(u"."_s))
+    {
+        WARN << "Failed creating directory" << dir.path();
+        return;
+    }
+
+    const auto name = QDateTime::currentDateTime().toString(u"yyyyMMdd-hhmmss"_s) + u".jsonl"_s;
+    auto file = make_unique<QFile>(dir.filePath(name));
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        WARN << "Failed opening session recording file:" << file->errorString();
+        return;
+    }
+
+    file_ = ::move(file);
+    timer_.start();
+    INFO << "Recording sessions to" << file_->fileName();
+}
+
+QString SessionRecorder::path() const { return file_ ? file_->fileName() : QString{}; }
+
+void SessionRecorder::record(initializer_list<pair<QString, QJsonValue>> fields)
+{
+    if (!file_)
+        return;
+
+    QJsonObject event(fields);
+    event.insert(u"t"_s, timer_.elapsed());
+    file_->write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+    file_->write("\n");
+    file_->flush();
+}
@@ -0,0 +1,33 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QElapsedTimer>
+#include <QJsonValue>
+#include <QString>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+class QFile;
+
+// Records timestamped query session events as JSON lines for offline analysis.
+class SessionRecorder
+{
+public:
+
+    SessionRecorder();
+    ~SessionRecorder();
+
+    [[nodiscard]] bool isEnabled() const;
+    void setEnabled(bool);
+
+    [[nodiscard]] QString path() const;
+
+    // Adds the timestamp `t` in milliseconds since the recording started. No-op if disabled.
+    void record(std::initializer_list<std::pair<QString, QJsonValue>> event);
+
+private:
+
+    std::unique_ptr<QFile> file_;
+    QElapsedTimer timer_;
+
+};
@@ -0,0 +1,170 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "tracer.h"
+#include <QDateTime>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <albert/app.h>
+#include <albert/logging.h>
+using namespace Qt::StringLiterals;
+using namespace albert;
+using namespace std;
+
+static const size_t max_events = 1'000'000;  // ~50 MB, bounds memory of forgotten traces
+
+Tracer::Span::Span(Span &&o) noexcept :
+    tracer_(o.tracer_),
+    name_(o.name_),
+    pid_(o.pid_),
+    tid_(o.tid_),
+    async_id_(o.async_id_),
+    start_(o.start_)
+{
+    o.tracer_ = nullptr;
+}
+
+Tracer::Span::~Span() { end(); }
+
+void Tracer::Span::end()
+{
+    if (!tracer_)
+        return;
+
+    const auto now = tracer_->clock_.nsecsElapsed() / 1000;
+    if (async_id_)
+    {
+        tracer_->add({'b', name_, pid_, tid_, async_id_, start_, 0, {}});
+        tracer_->add({'e', name_, pid_, tid_, async_id_, now, 0, {}});
+    }
+    else
+        tracer_->add({'X', name_, pid_, tid_, 0, start_, now - start_, {}});
+
+    tracer_ = nullptr;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+Tracer::Tracer() = default;
+
+Tracer::~Tracer()
+{
+    if (!events_.empty())
+        save();
+}
+
+bool Tracer::isEnabled() const { return enabled_; }
+
+void Tracer::setEnabled(bool enabled)
+{
+    if (enabled == enabled_)
+        return;
+
+    if ((enabled_ = enabled))
+    {
+        clock_.start();
+        INFO << "Tracing enabled.";
+    }
+    else
+    {
+        if (!events_.empty())
+            save();
+        INFO << "Tracing disabled.";
+    }
+}
+
+Tracer::Span Tracer::span(const char *name, qint64 pid, qint64 tid)
+{
+    Span s;
+    if (enabled_)
+    {
+        s.tracer_ = this;
+        s.name_ = name;
+        s.pid_ = pid;
+        s.tid_ = tid;
+        s.start_ = clock_.nsecsElapsed() / 1000;
+    }
+    return s;
+}
+
+Tracer::Span Tracer::asyncSpan(const char *name, qint64 pid, qint64 tid)
+{
+    auto s = span(name, pid, tid);
+    if (enabled_)
+        s.async_id_ = ++async_ids_;
+    return s;
+}
+
+void Tracer::setProcessName(qint64 pid, const QString &name)
+{
+    if (enabled_)
+        add({'M', "process_name", pid, 0, 0, 0, 0, name});
+}
+
+void Tracer::setLaneName(qint64 pid, qint64 tid, const QString &name)
+{
+    if (enabled_)
+        add({'M', "thread_name", pid, tid, 0, 0, 0, name});
+}
+
+void Tracer::add(Event &&event)
+{
+    if (events_.size() < max_events)
+        events_.emplace_back(::move(event));
+}
+
+QString Tracer::save()
+{
+    QJsonArray trace_events;
+    for (const auto &e : events_)
+    {
+        QJsonObject o{
+            {u"ph"_s, QString(QChar::fromLatin1(e.phase))},
+            {u"name"_s, QString::fromLatin1(e.name)},
+            {u"pid"_s, e.pid},
+            {u"ts"_s, e.ts}
+        };
+
+        switch (e.phase) {
+        case 'X':
+            o.insert(u"tid"_s, e.tid);
+            o.insert(u"dur"_s, e.dur);
+            break;
+        case 'b':
+        case 'e':
+            o.insert(u"tid"_s, e.tid);
+            o.insert(u"id"_s, e.id);
+            o.insert(u"cat"_s, QString::fromLatin1(e.name));
+            break;
+        case 'M':
+            o.insert(u"tid"_s, e.tid);
+            o.insert(u"args"_s, QJsonObject{{u"name"_s, e.label}});
+            break;
+        }
+
+        trace_events.append(o);
+    }
+    events_.clear();
+
+    const auto dir = QDir(app().cacheLocation() / "spotify" / "traces");
+    if (!dir.mkpath(u"."_s))
+    {
+        WARN << "Failed creating directory" << dir.path();
+        return {};
+    }
+
+    const auto name = QDateTime::currentDateTime().toString(u"yyyyMMdd-hhmmss"_s) + u".json"_s;
+    QSaveFile file(dir.filePath(name));
+    if (file.open(QIODevice::WriteOnly)
+        && file.write(QJsonDocument(QJsonObject{{u"traceEvents"_s, trace_events}}).toJson(QJsonDocument::Compact)) != -1
+        && file.commit())
+    {
+        INFO << "Wrote trace to" << file.fileName();
+        return file.fileName();
+    }
+
+    WARN << "Failed writing trace:" << file.errorString();
+    return {};
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QElapsedTimer>
+#include <QString>
+#include <vector>
+
+// Collects trace spans and writes them in the Chrome trace event format.
+// Spans on a lane (pid, tid) must not overlap, use async spans for concurrent work.
+class Tracer
+{
+public:
+
+    class Span
+    {
+    public:
+        Span(Span &&) noexcept;
+        Span &operator=(Span &&) = delete;
+        ~Span();
+        void end();
+
+    private:
+        friend class Tracer;
+        Span() = default;
+        Tracer *tracer_ = nullptr;
+        const char *name_ = nullptr;
+        qint64 pid_ = 0;
+        qint64 tid_ = 0;
+        qint64 async_id_ = 0;  // 0 for complete events
+        qint64 start_ = 0;
+    };
+
+    Tracer();
+    ~Tracer();
+
+    [[nodiscard]] bool isEnabled() const;
+    void setEnabled(bool);
+
+    // Complete event on the lane (pid, tid). No-op if disabled.
+    [[nodiscard]] Span span(const char *name, qint64 pid, qint64 tid);
+
+    // Async event in process pid, may overlap other spans. Tagged with the lane tid, e.g. the
+    // query it belongs to. No-op if disabled.
+    [[nodiscard]] Span asyncSpan(const char *name, qint64 pid, qint64 tid = 0);
+
+    void setProcessName(qint64 pid, const QString &name);
+    void setLaneName(qint64 pid, qint64 tid, const QString &name);
+
+    // Writes the trace to the cache and clears the events. Returns the file path.
+    QString save();
+
+private:
+
+    struct Event
+    {
+        char phase;
+        const char *name;
+        qint64 pid;
+        qint64 tid;
+        qint64 id;  // async events
+        qint64 ts;
+        qint64 dur;
+        QString label;  // metadata events
+    };
+
+    void add(Event &&);
+
+    bool enabled_ = false;
+    QElapsedTimer clock_;
+    qint64 async_ids_ = 0;
+    std::vector<Event> events_;
+
+};